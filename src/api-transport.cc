@@ -0,0 +1,261 @@
+#include "api-transport.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+// Only the start of the response body is kept when a call failed, for the error message
+static const std::size_t ErrorBodySize = 4096;
+
+/**
+ * \brief Parse the multiaddr of the IPFS API, like the 'Addresses.API' setting of the IPFS daemon.
+ * Supported: /ip4/<address>/tcp/<port>, /ip6/<address>/tcp/<port>, /dns/<host>/tcp/<port> (also dns4 & dns6)
+ * and /unix/<path> (eg. /unix/run/ipfs/api.sock). An optional /http suffix is allowed for the TCP addresses.
+ * \param multiaddr Multiaddr of the API
+ * \throw std::invalid_argument when the multiaddr is not supported
+ * \return API address
+ */
+ApiAddress ApiAddress::parse(const std::string& multiaddr)
+{
+  std::vector<std::string> parts;
+  std::size_t start = 0;
+  if (!multiaddr.starts_with("/"))
+    throw std::invalid_argument("Invalid IPFS API address: " + multiaddr + ". Expected a multiaddr, like /ip4/127.0.0.1/tcp/5001.");
+  while (start < multiaddr.size())
+  {
+    std::size_t end = multiaddr.find('/', start + 1);
+    if (end == std::string::npos)
+      end = multiaddr.size();
+    parts.push_back(multiaddr.substr(start + 1, end - start - 1));
+    start = end;
+  }
+
+  ApiAddress address;
+  if (parts.size() >= 2 && parts[0] == "unix" && multiaddr.size() > 6)
+  {
+    // The socket path is the remainder of the multiaddr
+    address.socket_path = multiaddr.substr(5);
+    return address;
+  }
+  bool is_host = parts.size() >= 4 && (parts[0] == "ip4" || parts[0] == "ip6" || parts[0] == "dns" || parts[0] == "dns4" || parts[0] == "dns6");
+  bool is_http = parts.size() == 4 || (parts.size() == 5 && parts[4] == "http");
+  if (is_host && is_http && !parts[1].empty() && parts[2] == "tcp")
+  {
+    char* port_end = nullptr;
+    long port = std::strtol(parts[3].c_str(), &port_end, 10);
+    if (!parts[3].empty() && *port_end == '\0' && port > 0 && port <= 65535)
+    {
+      address.host = parts[1];
+      address.port = static_cast<int>(port);
+      return address;
+    }
+  }
+  throw std::invalid_argument("Unsupported IPFS API address: " + multiaddr +
+                              ". Use a TCP address (like /ip4/127.0.0.1/tcp/5001) or a unix socket (like /unix/run/ipfs/api.sock).");
+}
+
+/**
+ * \brief Check if the API is reached via a unix domain socket
+ * \return true if unix socket, otherwise false (TCP)
+ */
+bool ApiAddress::is_unix_socket() const
+{
+  return !socket_path.empty();
+}
+
+/**
+ * \brief Check if the API is on this machine (unix socket or loopback address)
+ * \return true if local, otherwise false
+ */
+bool ApiAddress::is_local() const
+{
+  return is_unix_socket() || host == "localhost" || host.starts_with("127.") || host == "::1";
+}
+
+/**
+ * \brief Get the base URL of the API calls
+ * \return URL (eg. http://127.0.0.1:5001), the host name is not used for a unix socket
+ */
+std::string ApiAddress::get_base_url() const
+{
+  if (is_unix_socket())
+    return "http://localhost";
+  // IPv6 addresses are enclosed in brackets
+  if (host.find(':') != std::string::npos)
+    return "http://[" + host + "]:" + std::to_string(port);
+  return "http://" + host + ":" + std::to_string(port);
+}
+
+/**
+ * \brief Constructor, the connection is made during the first call
+ * \param address Address of the IPFS API
+ * \throw std::runtime_error when the transport could not be initialized
+ */
+ApiTransport::ApiTransport(const ApiAddress& address)
+    : address_(address),
+      is_stopped_(false),
+      chunk_callback_(nullptr)
+{
+  static std::once_flag curl_initialized;
+  std::call_once(curl_initialized, [] { curl_global_init(CURL_GLOBAL_ALL); });
+  curl_ = curl_easy_init();
+  if (curl_ == nullptr)
+    throw std::runtime_error("Could not initialize the HTTP transport.");
+  // Transports are used from several threads, so don't use signals (eg. for DNS time-outs)
+  curl_easy_setopt(curl_, CURLOPT_NOSIGNAL, 1L);
+  curl_easy_setopt(curl_, CURLOPT_WRITEFUNCTION, &ApiTransport::write_callback);
+  curl_easy_setopt(curl_, CURLOPT_WRITEDATA, this);
+  curl_easy_setopt(curl_, CURLOPT_NOPROGRESS, 0L);
+  curl_easy_setopt(curl_, CURLOPT_XFERINFOFUNCTION, &ApiTransport::progress_callback);
+  curl_easy_setopt(curl_, CURLOPT_XFERINFODATA, this);
+  if (address_.is_unix_socket())
+  {
+    curl_easy_setopt(curl_, CURLOPT_UNIX_SOCKET_PATH, address_.socket_path.c_str());
+    // A proxy (eg. from the environment) can't be used for a local socket
+    curl_easy_setopt(curl_, CURLOPT_PROXY, "");
+  }
+}
+
+/**
+ * \brief Destructor, closes the connection
+ */
+ApiTransport::~ApiTransport()
+{
+  curl_easy_cleanup(curl_);
+}
+
+/**
+ * \brief Call the API, while passing the response in chunks as they are received
+ * \param url URL of the call (see ApiAddress::get_base_url())
+ * \param chunk_callback Called for each received chunk of the response
+ * \throw std::runtime_error when the call failed, or was stopped ("Request was aborted")
+ */
+void ApiTransport::post(const std::string& url, const std::function<void(const char* data, std::size_t length)>& chunk_callback)
+{
+  chunk_callback_ = &chunk_callback;
+  perform(url, nullptr);
+}
+
+/**
+ * \brief Call the API with a file (multipart form), while passing the response in chunks as they are received
+ * \param url URL of the call (see ApiAddress::get_base_url())
+ * \param file_name File name of the uploaded file
+ * \param content Content of the uploaded file
+ * \param chunk_callback Called for each received chunk of the response
+ * \throw std::runtime_error when the call failed, or was stopped ("Request was aborted")
+ */
+void ApiTransport::post_file(const std::string& url,
+                             const std::string& file_name,
+                             const std::string& content,
+                             const std::function<void(const char* data, std::size_t length)>& chunk_callback)
+{
+  std::unique_ptr<curl_mime, void (*)(curl_mime*)> form(curl_mime_init(curl_), curl_mime_free);
+  curl_mimepart* part = curl_mime_addpart(form.get());
+  curl_mime_name(part, "file");
+  curl_mime_filename(part, file_name.c_str());
+  curl_mime_type(part, "application/octet-stream");
+  curl_mime_data(part, content.data(), content.size());
+  chunk_callback_ = &chunk_callback;
+  perform(url, form.get());
+}
+
+/**
+ * \brief URL-encode a value (eg. a path argument)
+ * \param value Value that needs to be encoded
+ * \return Encoded value
+ */
+std::string ApiTransport::escape(const std::string& value)
+{
+  char* escaped = curl_easy_escape(curl_, value.data(), static_cast<int>(value.size()));
+  if (escaped == nullptr)
+    throw std::runtime_error("Could not encode the value: " + value);
+  std::string result(escaped);
+  curl_free(escaped);
+  return result;
+}
+
+/**
+ * Stop the on-going call abruptly, the next calls fail directly until reset() is called. Can be called from any thread.
+ */
+void ApiTransport::stop()
+{
+  is_stopped_ = true;
+}
+
+/**
+ * Allow new calls again, after stop()
+ */
+void ApiTransport::reset()
+{
+  is_stopped_ = false;
+}
+
+/**
+ * Perform the call, with an empty body or with the form (when not nullptr)
+ */
+void ApiTransport::perform(const std::string& url, curl_mime* form)
+{
+  if (is_stopped_)
+    throw std::runtime_error("Request was aborted");
+  char error_buffer[CURL_ERROR_SIZE] = "";
+  error_body_.clear();
+  curl_easy_setopt(curl_, CURLOPT_URL, url.c_str());
+  curl_easy_setopt(curl_, CURLOPT_ERRORBUFFER, error_buffer);
+  if (form != nullptr)
+  {
+    curl_easy_setopt(curl_, CURLOPT_MIMEPOST, form);
+  }
+  else
+  {
+    curl_easy_setopt(curl_, CURLOPT_POSTFIELDSIZE, 0L);
+    curl_easy_setopt(curl_, CURLOPT_POSTFIELDS, "");
+  }
+  CURLcode result = curl_easy_perform(curl_);
+  long status = 0;
+  curl_easy_getinfo(curl_, CURLINFO_RESPONSE_CODE, &status);
+  // The handle should not refer to the buffers of this call anymore
+  curl_easy_setopt(curl_, CURLOPT_ERRORBUFFER, nullptr);
+  if (form != nullptr)
+    curl_easy_setopt(curl_, CURLOPT_MIMEPOST, nullptr);
+  chunk_callback_ = nullptr;
+
+  if (is_stopped_ && (result == CURLE_ABORTED_BY_CALLBACK || result == CURLE_WRITE_ERROR))
+    throw std::runtime_error("Request was aborted");
+  if (result != CURLE_OK)
+    throw std::runtime_error(std::string(curl_easy_strerror(result)) + ": " + error_buffer);
+  if (status < 200 || status >= 300)
+    throw std::runtime_error("HTTP request failed with status code " + std::to_string(status) + ":\n" + error_body_);
+}
+
+/**
+ * Receive a chunk of the response, the body of a failed call is kept for the error message instead
+ */
+std::size_t ApiTransport::write_callback(char* data, std::size_t size, std::size_t count, void* user_data)
+{
+  ApiTransport* transport = static_cast<ApiTransport*>(user_data);
+  std::size_t length = size * count;
+  if (transport->is_stopped_)
+    return 0;
+  long status = 0;
+  curl_easy_getinfo(transport->curl_, CURLINFO_RESPONSE_CODE, &status);
+  if (status >= 300)
+  {
+    if (transport->error_body_.size() < ErrorBodySize)
+      transport->error_body_.append(data, std::min(length, ErrorBodySize - transport->error_body_.size()));
+    return length;
+  }
+  (*transport->chunk_callback_)(data, length);
+  // The callback can stop the call as well (eg. when the content is not needed anymore)
+  return transport->is_stopped_ ? 0 : length;
+}
+
+/**
+ * Called periodically during the call, returning non-zero stops the call
+ */
+int ApiTransport::progress_callback(void* user_data, curl_off_t, curl_off_t, curl_off_t, curl_off_t)
+{
+  return static_cast<ApiTransport*>(user_data)->is_stopped_ ? 1 : 0;
+}
@@ -0,0 +1,60 @@
+#ifndef API_TRANSPORT_H
+#define API_TRANSPORT_H
+
+#include <atomic>
+#include <cstddef>
+#include <curl/curl.h>
+#include <functional>
+#include <string>
+
+/**
+ * \struct ApiAddress
+ * \brief Address of the IPFS HTTP API, either a TCP address or a unix domain socket
+ */
+struct ApiAddress
+{
+  std::string host;        /* Host name or IP address, empty when a unix socket is used */
+  int port = 0;            /* TCP port number, zero when a unix socket is used */
+  std::string socket_path; /* Path of the unix domain socket, empty when TCP is used */
+
+  static ApiAddress parse(const std::string& multiaddr);
+  bool is_unix_socket() const;
+  bool is_local() const;
+  std::string get_base_url() const;
+};
+
+/**
+ * \class ApiTransport
+ * \brief HTTP transport for the IPFS API calls, over TCP or over a unix domain socket.
+ * The transport keeps its handle between the calls, so the (keep-alive) connection to the daemon is reused.
+ * Used by a single thread at a time, except for stop() which can be called from any thread.
+ */
+class ApiTransport
+{
+public:
+  explicit ApiTransport(const ApiAddress& address);
+  ~ApiTransport();
+  ApiTransport(const ApiTransport&) = delete;
+  ApiTransport& operator=(const ApiTransport&) = delete;
+  void post(const std::string& url, const std::function<void(const char* data, std::size_t length)>& chunk_callback);
+  void post_file(const std::string& url,
+                 const std::string& file_name,
+                 const std::string& content,
+                 const std::function<void(const char* data, std::size_t length)>& chunk_callback);
+  std::string escape(const std::string& value);
+  void stop();
+  void reset();
+
+private:
+  ApiAddress address_;                                                  /* Address of the IPFS API */
+  CURL* curl_;                                                          /* Handle, with the connection cache */
+  std::atomic<bool> is_stopped_;                                        /* Stop the on-going (and the next) calls, until reset() */
+  const std::function<void(const char*, std::size_t)>* chunk_callback_; /* Receives the response of the on-going call */
+  std::string error_body_;                                              /* Start of the response body, when the call failed */
+
+  void perform(const std::string& url, curl_mime* form);
+  static std::size_t write_callback(char* data, std::size_t size, std::size_t count, void* user_data);
+  static int progress_callback(void* user_data, curl_off_t total_download, curl_off_t now_download, curl_off_t total_upload, curl_off_t now_upload);
+};
+
+#endif
@@ -0,0 +1,14 @@
+#ifndef CONTENT_BUFFER_H
+#define CONTENT_BUFFER_H
+
+#include <memory>
+#include <string>
+
+/**
+ * \brief Immutable, reference-counted plain-text content (eg. the markdown of a page).
+ * The content is shared between the workers, the caches and the GUI without copying it,
+ * passing it to another thread only copies the pointer.
+ */
+typedef std::shared_ptr<const std::string> ContentBuffer;
+
+#endif
@@ -0,0 +1,201 @@
+#include "content-sniffer.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+// Bytes of the content start that are kept, to detect the file type (the tar magic number is at offset 257)
+static const std::size_t SniffPrefixSize = 264;
+// Type of non-text content without a known magic number
+static const char* const BinaryType = "binary data";
+// Word-at-a-time masks, used to skip plain ASCII text 8 bytes at a time
+static const std::uint64_t HighBitsMask = 0x8080808080808080ULL;
+static const std::uint64_t LowBitsMask = 0x0101010101010101ULL;
+
+namespace
+{
+  /**
+   * \struct MagicNumber
+   * \brief Signature of a known binary format at a fixed offset
+   */
+  struct MagicNumber
+  {
+    std::size_t offset;
+    const char* signature;
+    std::size_t length;
+    const char* type;
+  };
+
+  const MagicNumber MagicNumbers[] = {
+      {0, "\x89PNG\r\n\x1A\n", 8, "PNG image"},
+      {0, "\xFF\xD8\xFF", 3, "JPEG image"},
+      {0, "GIF87a", 6, "GIF image"},
+      {0, "GIF89a", 6, "GIF image"},
+      {8, "WEBP", 4, "WebP image"},
+      {8, "AVI ", 4, "AVI video"},
+      {8, "WAVE", 4, "WAV audio"},
+      {4, "ftyp", 4, "MP4 video"},
+      {0, "\x1A\x45\xDF\xA3", 4, "Matroska/WebM video"},
+      {0, "OggS", 4, "Ogg media"},
+      {0, "ID3", 3, "MP3 audio"},
+      {0, "fLaC", 4, "FLAC audio"},
+      {0, "%PDF-", 5, "PDF document"},
+      {0, "PK\x03\x04", 4, "ZIP archive"},
+      {0, "\x1F\x8B", 2, "gzip archive"},
+      {0, "\xFD" "7zXZ", 6, "XZ archive"},
+      {0, "7z\xBC\xAF\x27\x1C", 6, "7-Zip archive"},
+      {0, "\x28\xB5\x2F\xFD", 4, "Zstandard archive"},
+      {257, "ustar", 5, "tar archive"},
+      {0, "\x7F" "ELF", 4, "executable"},
+      {0, "\0asm", 4, "WebAssembly module"},
+  };
+} // namespace
+
+ContentSniffer::ContentSniffer()
+    : is_text_(true),
+      remaining_(0),
+      lower_(0x80),
+      upper_(0xBF)
+{
+}
+
+/**
+ * \brief Feed the next chunk of content, the chunks after non-text content is detected are only used to detect the type
+ * \param data Pointer to the chunk
+ * \param length Length of the chunk in bytes
+ * \return true if the content is still (UTF-8) text so far, false when non-text content is detected
+ */
+bool ContentSniffer::feed(const char* data, std::size_t length)
+{
+  bool is_prefix_extended = prefix_.size() < SniffPrefixSize && length > 0;
+  if (is_prefix_extended)
+    prefix_.append(data, std::min(length, SniffPrefixSize - prefix_.size()));
+  if (!is_text_)
+  {
+    // The type of non-text content may still be detected, when more of the content start is received
+    if (is_prefix_extended && type_ == BinaryType)
+      check_type();
+    return false;
+  }
+  if (!validate(reinterpret_cast<const unsigned char*>(data), length))
+  {
+    set_binary();
+    return false;
+  }
+  return true;
+}
+
+/**
+ * \brief All content is received, a character that is cut-off at the end is invalid
+ * \return true if the whole content is (UTF-8) text, otherwise false
+ */
+bool ContentSniffer::finish()
+{
+  if (is_text_ && remaining_ > 0)
+    set_binary();
+  return is_text_;
+}
+
+/**
+ * \brief Check if the content is (UTF-8) text so far
+ * \return true if text, otherwise false
+ */
+bool ContentSniffer::is_text() const
+{
+  return is_text_;
+}
+
+/**
+ * \brief Get the detected type of non-text content (eg. "PNG image")
+ * \return Type description, "binary data" for an unknown format, empty when the content is text
+ */
+const std::string& ContentSniffer::get_type() const
+{
+  return type_;
+}
+
+/**
+ * Validate the chunk as UTF-8, continuing with the character that is cut-off at the end of the previous chunk.
+ * Overlong encodings, surrogates, code points above U+10FFFF and null characters are invalid (like g_utf8_validate()).
+ */
+bool ContentSniffer::validate(const unsigned char* data, std::size_t length)
+{
+  std::size_t i = 0;
+  while (i < length)
+  {
+    unsigned char c = data[i];
+    if (remaining_ > 0)
+    {
+      if (c < lower_ || c > upper_)
+        return false;
+      lower_ = 0x80;
+      upper_ = 0xBF;
+      --remaining_;
+      ++i;
+      continue;
+    }
+    // Fast path: skip 8 ASCII characters (without null characters) at once
+    if (i + sizeof(std::uint64_t) <= length)
+    {
+      std::uint64_t word;
+      std::memcpy(&word, data + i, sizeof(word));
+      if (((word | ((word - LowBitsMask) & ~word)) & HighBitsMask) == 0)
+      {
+        i += sizeof(word);
+        continue;
+      }
+    }
+    if (c == 0)
+      return false;
+    if (c >= 0x80)
+    {
+      if (c < 0xC2 || c > 0xF4)
+        return false;
+      if (c < 0xE0)
+      {
+        remaining_ = 1;
+      }
+      else if (c < 0xF0)
+      {
+        remaining_ = 2;
+        lower_ = (c == 0xE0) ? 0xA0 : 0x80; // Overlong
+        upper_ = (c == 0xED) ? 0x9F : 0xBF; // Surrogates
+      }
+      else
+      {
+        remaining_ = 3;
+        lower_ = (c == 0xF0) ? 0x90 : 0x80; // Overlong
+        upper_ = (c == 0xF4) ? 0x8F : 0xBF; // Above U+10FFFF
+      }
+    }
+    ++i;
+  }
+  return true;
+}
+
+/**
+ * Mark the content as non-text, and detect the type based on the content start
+ */
+void ContentSniffer::set_binary()
+{
+  is_text_ = false;
+  check_type();
+  if (type_.empty())
+    type_ = BinaryType;
+}
+
+/**
+ * Detect the type of non-text content by the known binary formats. Text that starts with a signature of a format
+ * (eg. "ID3" or "%PDF-") stays text, all these formats contain invalid UTF-8 within their first bytes.
+ */
+void ContentSniffer::check_type()
+{
+  for (const MagicNumber& magic : MagicNumbers)
+  {
+    if (prefix_.size() >= magic.offset + magic.length && prefix_.compare(magic.offset, magic.length, magic.signature, magic.length) == 0)
+    {
+      type_ = magic.type;
+      return;
+    }
+  }
+}
@@ -0,0 +1,35 @@
+#ifndef CONTENT_SNIFFER_H
+#define CONTENT_SNIFFER_H
+
+#include <cstddef>
+#include <string>
+
+/**
+ * \class ContentSniffer
+ * \brief Check if content is (UTF-8) text while it is still being received, chunk by chunk.
+ * Non-text content (eg. an image, video or archive) is detected within the first bytes,
+ * so the download can be stopped early. The type of non-text content is detected by the magic number of known formats.
+ */
+class ContentSniffer
+{
+public:
+  ContentSniffer();
+  bool feed(const char* data, std::size_t length);
+  bool finish();
+  bool is_text() const;
+  const std::string& get_type() const;
+
+private:
+  std::string prefix_;  /* Start of the content, to detect the file type */
+  std::string type_;    /* Detected type of non-text content, empty when text */
+  bool is_text_;        /* Valid (UTF-8) text so far */
+  int remaining_;       /* Continuation bytes still expected for the current character */
+  unsigned char lower_; /* Lowest valid value of the next continuation byte */
+  unsigned char upper_; /* Highest valid value of the next continuation byte */
+
+  bool validate(const unsigned char* data, std::size_t length);
+  void set_binary();
+  void check_type();
+};
+
+#endif
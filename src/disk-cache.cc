@@ -0,0 +1,258 @@
+#include "disk-cache.h"
+#include "file.h"
+#include "render-document.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <glib.h>
+#include <iostream>
+#include <vector>
+
+#ifdef LEGACY_CXX
+#include <experimental/filesystem>
+namespace n_fs = ::std::experimental::filesystem;
+#else
+#include <filesystem>
+namespace n_fs = ::std::filesystem;
+#endif
+
+// Entry file format version, increase when the format (or the render document format) changes
+static const char EntryMagic[8] = {'L', 'W', 'C', 'A', 'C', 'H', 'E', 2};
+static const char* const EntryExtension = ".cache";
+// FNV-1a (64-bit) hash constants
+static const std::uint64_t FnvOffsetBasis = 14695981039346656037ULL;
+static const std::uint64_t FnvPrime = 1099511628211ULL;
+
+namespace
+{
+  /**
+   * \struct EntryHeader
+   * \brief Header of a cache entry file, followed by the key, the content and the serialized document
+   */
+  struct EntryHeader
+  {
+    char magic[8];
+    std::uint32_t op_size;         /* Size of a render operation, the operations are stored as-is */
+    std::uint32_t block_size;      /* Size of a render block, the blocks are stored as-is */
+    std::uint64_t key_length;      /* Length of the cache key in bytes */
+    std::uint64_t content_length;  /* Length of the raw content in bytes */
+    std::uint64_t document_length; /* Length of the serialized render document in bytes, zero if not available */
+    std::uint64_t checksum;        /* Checksum of all the data after the header */
+  };
+} // namespace
+
+/**
+ * \brief Constructor, the cache directory is created when the first entry is stored
+ * \param directory Cache directory
+ * \param max_bytes Disk space limit of the cache
+ */
+DiskCache::DiskCache(const std::string& directory, std::size_t max_bytes)
+    : directory_(directory),
+      max_bytes_(max_bytes)
+{
+}
+
+/**
+ * \brief Change the disk space limit, the least recently used entries are removed directly when needed
+ * \param max_bytes Disk space limit of the cache
+ */
+void DiskCache::set_max_bytes(std::size_t max_bytes)
+{
+  std::lock_guard<std::mutex> guard(mutex_);
+  max_bytes_ = max_bytes;
+  evict();
+}
+
+/**
+ * \brief Load a cached entry, the entry becomes the most recently used entry.
+ * Invalid entries (eg. corrupt or from an older version) are removed.
+ * \param key Cache key (see DocumentCache::get_key())
+ * \param entry Cached content and document (if found), the document is nullptr when only the content is cached
+ * \return true if found, otherwise false
+ */
+bool DiskCache::load(const std::string& key, CachedDocument& entry)
+{
+  if (key.empty())
+    return false;
+  std::lock_guard<std::mutex> guard(mutex_);
+  std::string path = get_path(key);
+  std::error_code error;
+  if (!n_fs::is_regular_file(path, error))
+    return false;
+
+  bool is_valid = false;
+  {
+    MappedFile file(path);
+    EntryHeader header;
+    if (file.size() >= sizeof(header))
+    {
+      std::memcpy(&header, file.data(), sizeof(header));
+      const char* data = file.data() + sizeof(header);
+      std::size_t size = file.size() - sizeof(header);
+      is_valid = std::memcmp(header.magic, EntryMagic, sizeof(EntryMagic)) == 0 && header.op_size == sizeof(RenderOp) &&
+                 header.block_size == sizeof(RenderBlock) && header.key_length <= size && header.content_length <= size - header.key_length &&
+                 header.document_length == size - header.key_length - header.content_length && get_checksum(data, size) == header.checksum;
+      // Different key with the same file name is not invalid, just not found
+      if (is_valid && key.compare(0, std::string::npos, data, header.key_length) != 0)
+        return false;
+      // The content is shown in the text buffers (eg. the source code), which requires valid UTF-8
+      if (is_valid && !g_utf8_validate(data + header.key_length, static_cast<gssize>(header.content_length), nullptr))
+        is_valid = false;
+      if (is_valid)
+      {
+        data += header.key_length;
+        entry.content = std::make_shared<const std::string>(data, header.content_length);
+        entry.document = nullptr;
+        if (header.document_length > 0)
+        {
+          entry.document = RenderDocument::deserialize(data + header.content_length, header.document_length);
+          is_valid = entry.document != nullptr;
+        }
+      }
+    }
+  }
+  if (!is_valid)
+  {
+    std::cerr << "WARN: Removing invalid cache entry: " << path << std::endl;
+    n_fs::remove(path, error);
+    entry = CachedDocument();
+    return false;
+  }
+  // Mark as recently used
+  n_fs::last_write_time(path, n_fs::file_time_type::clock::now(), error);
+  return true;
+}
+
+/**
+ * \brief Store content in the cache (or replace the existing entry), the compiled document is optional.
+ * The entry is written to a temporary file first, so an entry is never partially written.
+ * \param key Cache key (see DocumentCache::get_key())
+ * \param entry Content and the compiled document (if available)
+ */
+void DiskCache::store(const std::string& key, const CachedDocument& entry)
+{
+  if (key.empty() || !entry.content)
+    return;
+  std::lock_guard<std::mutex> guard(mutex_);
+  EntryHeader header;
+  std::memcpy(header.magic, EntryMagic, sizeof(EntryMagic));
+  header.op_size = sizeof(RenderOp);
+  header.block_size = sizeof(RenderBlock);
+  header.key_length = key.size();
+  header.content_length = entry.content->size();
+  std::string data;
+  data.reserve(sizeof(header) + key.size() + entry.content->size());
+  data.append(sizeof(header), '\0');
+  data.append(key);
+  data.append(*entry.content);
+  if (entry.document)
+    entry.document->serialize(data);
+  header.document_length = data.size() - sizeof(header) - key.size() - entry.content->size();
+  header.checksum = get_checksum(data.data() + sizeof(header), data.size() - sizeof(header));
+  std::memcpy(data.data(), &header, sizeof(header));
+  if (data.size() > max_bytes_)
+    return;
+
+  std::error_code error;
+  n_fs::create_directories(directory_, error);
+  std::string path = get_path(key);
+  std::string temp_path = path + ".tmp";
+  {
+    std::ofstream file(temp_path, std::ios::binary | std::ios::trunc);
+    file.write(data.data(), static_cast<std::streamsize>(data.size()));
+    if (!file)
+    {
+      std::cerr << "WARN: Could not write cache entry: " << temp_path << std::endl;
+      file.close();
+      n_fs::remove(temp_path, error);
+      return;
+    }
+  }
+  n_fs::rename(temp_path, path, error);
+  if (error)
+  {
+    std::cerr << "WARN: Could not store cache entry: " << path << ". Message: " << error.message() << std::endl;
+    n_fs::remove(temp_path, error);
+    return;
+  }
+  evict();
+}
+
+/**
+ * \brief Remove all entries
+ */
+void DiskCache::clear()
+{
+  std::lock_guard<std::mutex> guard(mutex_);
+  std::error_code error;
+  for (const auto& dir_entry : n_fs::directory_iterator(directory_, error))
+  {
+    if (dir_entry.path().extension() == EntryExtension)
+      n_fs::remove(dir_entry.path(), error);
+  }
+}
+
+/**
+ * File path of the cache entry, based on the hash of the key
+ */
+std::string DiskCache::get_path(const std::string& key) const
+{
+  static const char* const hex_digits = "0123456789abcdef";
+  std::uint64_t hash = get_checksum(key.data(), key.size());
+  std::string file_name(16, '0');
+  for (int i = 15; i >= 0; --i, hash >>= 4)
+  {
+    file_name[i] = hex_digits[hash & 0xF];
+  }
+  return (n_fs::path(directory_) / (file_name + EntryExtension)).string();
+}
+
+/**
+ * Remove the least recently used entries, until the cache is within the disk space limit
+ */
+void DiskCache::evict()
+{
+  struct FileInfo
+  {
+    n_fs::file_time_type time;
+    std::uintmax_t size;
+    n_fs::path path;
+  };
+  std::vector<FileInfo> files;
+  std::uintmax_t total_size = 0;
+  std::error_code error;
+  for (const auto& dir_entry : n_fs::directory_iterator(directory_, error))
+  {
+    if (dir_entry.path().extension() != EntryExtension)
+      continue;
+    FileInfo info = {n_fs::last_write_time(dir_entry.path(), error), n_fs::file_size(dir_entry.path(), error), dir_entry.path()};
+    if (error)
+      continue;
+    total_size += info.size;
+    files.push_back(std::move(info));
+  }
+  if (total_size <= max_bytes_)
+    return;
+  std::sort(files.begin(), files.end(), [](const FileInfo& a, const FileInfo& b) { return a.time < b.time; });
+  for (const FileInfo& info : files)
+  {
+    if (total_size <= max_bytes_)
+      break;
+    if (n_fs::remove(info.path, error))
+      total_size -= info.size;
+  }
+}
+
+/**
+ * FNV-1a (64-bit) hash of the data
+ */
+std::uint64_t DiskCache::get_checksum(const char* data, std::size_t size)
+{
+  std::uint64_t hash = FnvOffsetBasis;
+  for (std::size_t i = 0; i < size; ++i)
+  {
+    hash ^= static_cast<unsigned char>(data[i]);
+    hash *= FnvPrime;
+  }
+  return hash;
+}
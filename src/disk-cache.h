@@ -0,0 +1,39 @@
+#ifndef DISK_CACHE_H
+#define DISK_CACHE_H
+
+#include "document-cache.h"
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+/**
+ * \class DiskCache
+ * \brief Persistent cache of immutable content (see DocumentCache::get_key()), stored in the cache directory.
+ * Each entry is a single file with the raw content and the serialized render document, so a cached document
+ * can be displayed directly after a (cold) start without fetching or parsing it again.
+ * Entries are memory-mapped when loaded and verified with a checksum, invalid entries are removed.
+ * The least recently used entries are removed when the cache uses more disk space than the limit.
+ */
+class DiskCache
+{
+public:
+  explicit DiskCache(const std::string& directory, std::size_t max_bytes = DefaultMaxBytes);
+  void set_max_bytes(std::size_t max_bytes);
+  bool load(const std::string& key, CachedDocument& entry);
+  void store(const std::string& key, const CachedDocument& entry);
+  void clear();
+
+  static const std::size_t DefaultMaxBytes = 256 * 1024 * 1024;
+
+private:
+  std::mutex mutex_;
+  std::string directory_; /* Cache directory */
+  std::size_t max_bytes_; /* Disk space limit */
+
+  std::string get_path(const std::string& key) const;
+  void evict();
+  static std::uint64_t get_checksum(const char* data, std::size_t size);
+};
+
+#endif
@@ -0,0 +1,176 @@
+#include "document-cache.h"
+#include "render-document.h"
+#include <algorithm>
+#include <cctype>
+
+/**
+ * \brief Constructor
+ * \param max_bytes Memory limit of the cache
+ */
+DocumentCache::DocumentCache(std::size_t max_bytes)
+    : max_bytes_(max_bytes),
+      used_bytes_(0)
+{
+}
+
+/**
+ * \brief Change the memory limit, the least recently used entries are dropped directly when needed
+ * \param max_bytes Memory limit of the cache
+ */
+void DocumentCache::set_max_bytes(std::size_t max_bytes)
+{
+  std::lock_guard<std::mutex> guard(mutex_);
+  max_bytes_ = max_bytes;
+  evict();
+}
+
+/**
+ * \brief Look-up cached content, the entry becomes the most recently used entry
+ * \param key Cache key (see get_key())
+ * \param entry Cached content and document (if found)
+ * \return true if found, otherwise false
+ */
+bool DocumentCache::get(const std::string& key, CachedDocument& entry)
+{
+  std::lock_guard<std::mutex> guard(mutex_);
+  auto it = index_.find(key);
+  if (it == index_.end())
+    return false;
+  entries_.splice(entries_.begin(), entries_, it->second);
+  entry = it->second->value;
+  return true;
+}
+
+/**
+ * \brief Add content to the cache (or replace the existing entry). Content larger than the memory limit is not cached.
+ * \param key Cache key (see get_key())
+ * \param content Raw content
+ * \param document Compiled document of the content (optional)
+ */
+void DocumentCache::put(const std::string& key, ContentBuffer content, std::shared_ptr<const RenderDocument> document)
+{
+  if (key.empty() || !content)
+    return;
+  std::lock_guard<std::mutex> guard(mutex_);
+  auto it = index_.find(key);
+  if (it != index_.end())
+  {
+    used_bytes_ -= it->second->bytes;
+    entries_.erase(it->second);
+    index_.erase(it);
+  }
+  Entry entry = {key, {std::move(content), std::move(document)}, 0};
+  entry.bytes = get_entry_bytes(entry);
+  if (entry.bytes > max_bytes_)
+    return;
+  entries_.push_front(std::move(entry));
+  index_.emplace(key, entries_.begin());
+  used_bytes_ += entries_.front().bytes;
+  evict();
+}
+
+/**
+ * \brief Add the compiled document to an existing entry, so the content doesn't need to be parsed again.
+ * The entry becomes the most recently used entry.
+ * \param key Cache key (see get_key())
+ * \param document Compiled document of the cached content
+ */
+void DocumentCache::set_document(const std::string& key, std::shared_ptr<const RenderDocument> document)
+{
+  std::lock_guard<std::mutex> guard(mutex_);
+  auto it = index_.find(key);
+  if (it == index_.end())
+    return;
+  entries_.splice(entries_.begin(), entries_, it->second);
+  Entry& entry = entries_.front();
+  used_bytes_ -= entry.bytes;
+  entry.value.document = std::move(document);
+  entry.bytes = get_entry_bytes(entry);
+  // Keep the content cached, when the document is too large to be cached
+  if (entry.bytes > max_bytes_)
+  {
+    entry.value.document.reset();
+    entry.bytes = get_entry_bytes(entry);
+  }
+  used_bytes_ += entry.bytes;
+  evict();
+}
+
+/**
+ * \brief Remove all entries
+ */
+void DocumentCache::clear()
+{
+  std::lock_guard<std::mutex> guard(mutex_);
+  entries_.clear();
+  index_.clear();
+  used_bytes_ = 0;
+}
+
+/**
+ * \brief Get the number of cached entries
+ */
+std::size_t DocumentCache::get_entry_count() const
+{
+  std::lock_guard<std::mutex> guard(mutex_);
+  return entries_.size();
+}
+
+/**
+ * \brief Get the (approximate) memory usage of the cached content and documents
+ * \return Number of bytes
+ */
+std::size_t DocumentCache::get_memory_usage() const
+{
+  std::lock_guard<std::mutex> guard(mutex_);
+  return used_bytes_;
+}
+
+/**
+ * \brief Get the cache key of an IPFS path. Only paths starting with a CID refer to immutable content,
+ * other paths (eg. IPNS names) can change and are not cached.
+ * \param path IPFS path, like: QmXyz/index.md, /ipfs/bafyXyz or /ipns/example.org
+ * \return Cache key (CID with the optional sub-path), empty string if the path can't be cached
+ */
+std::string DocumentCache::get_key(const std::string& path)
+{
+  std::string key = path;
+  if (key.starts_with("/ipfs/"))
+    key.erase(0, 6);
+  else if (key.starts_with("ipfs/"))
+    key.erase(0, 5);
+  while (!key.empty() && key.back() == '/')
+  {
+    key.pop_back();
+  }
+  std::string cid = key.substr(0, key.find('/'));
+  bool is_alphanumeric = std::all_of(cid.begin(), cid.end(), [](unsigned char c) { return std::isalnum(c); });
+  // CIDv0 (base58, always 46 characters) or CIDv1 (multibase prefix, mostly base32 'b' or base58 'z')
+  bool is_cid = is_alphanumeric && ((cid.length() == 46 && cid.starts_with("Qm")) ||
+                                    (cid.length() >= 48 && (cid.starts_with('b') || cid.starts_with('z'))));
+  return is_cid ? key : std::string();
+}
+
+/**
+ * Drop the least recently used entries until the cache is within the memory limit
+ */
+void DocumentCache::evict()
+{
+  while (used_bytes_ > max_bytes_ && !entries_.empty())
+  {
+    used_bytes_ -= entries_.back().bytes;
+    index_.erase(entries_.back().key);
+    entries_.pop_back();
+  }
+}
+
+/**
+ * Memory usage of an entry (content, document and bookkeeping)
+ */
+std::size_t DocumentCache::get_entry_bytes(const Entry& entry)
+{
+  std::size_t bytes = sizeof(Entry) + 2 * entry.key.capacity() + entry.value.content->capacity();
+  if (entry.value.document)
+    bytes += entry.value.document->get_memory_usage();
+  return bytes;
+}
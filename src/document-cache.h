@@ -0,0 +1,68 @@
+#ifndef DOCUMENT_CACHE_H
+#define DOCUMENT_CACHE_H
+
+#include "content-buffer.h"
+#include <cstddef>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+/* Forward declarations */
+class RenderDocument;
+
+/**
+ * \struct CachedDocument
+ * \brief Cached content of an immutable (IPFS) path, the compiled document is optional
+ */
+struct CachedDocument
+{
+  ContentBuffer content;                          /* Raw (markdown) content */
+  std::shared_ptr<const RenderDocument> document; /* Compiled document, nullptr if not compiled yet */
+};
+
+/**
+ * \class DocumentCache
+ * \brief In-memory cache of immutable content, keyed by the CID (+ sub-path) of the content.
+ * The least recently used entries are dropped when the cache uses more memory than the limit.
+ * Can be used from any thread.
+ */
+class DocumentCache
+{
+public:
+  explicit DocumentCache(std::size_t max_bytes = DefaultMaxBytes);
+  void set_max_bytes(std::size_t max_bytes);
+  bool get(const std::string& key, CachedDocument& entry);
+  void put(const std::string& key, ContentBuffer content, std::shared_ptr<const RenderDocument> document = nullptr);
+  void set_document(const std::string& key, std::shared_ptr<const RenderDocument> document);
+  void clear();
+  std::size_t get_entry_count() const;
+  std::size_t get_memory_usage() const;
+  static std::string get_key(const std::string& path);
+
+  static const std::size_t DefaultMaxBytes = 64 * 1024 * 1024;
+
+private:
+  /**
+   * \struct Entry
+   * \brief Cache entry, with its memory usage
+   */
+  struct Entry
+  {
+    std::string key;
+    CachedDocument value;
+    std::size_t bytes;
+  };
+
+  mutable std::mutex mutex_;
+  std::size_t max_bytes_;
+  std::size_t used_bytes_;
+  std::list<Entry> entries_; /* Most recently used entry first */
+  std::unordered_map<std::string, std::list<Entry>::iterator> index_;
+
+  void evict();
+  static std::size_t get_entry_bytes(const Entry& entry);
+};
+
+#endif
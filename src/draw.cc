@@ -1,34 +1,42 @@
 #include "draw.h"
 #include "middleware-i.h"
-#include "node.h"
-#include "syntax_extension.h"
-#include <cmark-gfm.h>
+#include <algorithm>
+#include <chrono>
 #include <cstdint>
 #include <gdkmm/window.h>
 #include <glibmm.h>
 #include <gtkmm/textiter.h>
 #include <iostream>
+#include <iterator>
+#include <limits>
 #include <regex>
 #include <stdexcept>
 
+// Maximum time spend on drawing the document at once, before handling events again
+static const std::chrono::milliseconds RenderSliceDuration(8);
+// Number of operations drawn between checking the time
+static const int RenderOpsPerTimeCheck = 64;
+// Number of unused heading titles that are kept, before the heading titles are compacted
+static const std::size_t HeadingTitlesSpare = 64;
+// Number of unused link URLs that are kept, before the link URLs are compacted
+static const std::size_t LinkUrlsSpare = 64;
+
 Draw::Draw(MiddlewareInterface& middleware)
     : middleware_(middleware),
       add_view_source_menu_item_(true),
-      heading_level_(0),
-      list_level_(0),
-      is_bold_(false),
-      is_italic_(false),
-      is_strikethrough_(false),
-      is_highlight_(false),
-      is_superscript_(false),
-      is_subscript_(false),
-      is_quote_(false),
-      bullet_list_level_(0),
-      ordered_list_level_(0),
-      is_ordered_list_(false),
-      is_link(false),
       hoving_over_link_(false),
-      is_user_action_(false)
+      is_user_action_(false),
+      pending_scroll_offset_(-1),
+      render_op_index_(0),
+      render_block_index_(0),
+      is_render_block_started_(false),
+      render_block_fingerprint_(0),
+      render_block_start_line_(0),
+      render_block_char_offset_(0),
+      render_block_heading_index_(0),
+      cursor_tick_id_(0),
+      pointer_x_(0),
+      pointer_y_(0)
 {
   this->disable_edit();
   set_top_margin(12);
@@ -52,6 +60,9 @@ Draw::Draw(MiddlewareInterface& middleware)
 
   // Create text-tags
   add_tags();
+  // Position where the document is rendered, with right gravity so it moves along with the inserted text
+  render_mark_ = get_buffer()->create_mark(get_buffer()->end(), false);
+  scroll_mark_ = get_buffer()->create_mark(get_buffer()->begin(), true);
 
   // Connect Signals
   signal_event_after().connect(sigc::mem_fun(this, &Draw::event_after));
@@ -60,6 +71,16 @@ Draw::Draw(MiddlewareInterface& middleware)
   signal_populate_popup().connect(sigc::mem_fun(this, &Draw::populate_popup));
 }
 
+/**
+ * \brief Destructor, stop drawing the documents that are not drawn yet
+ */
+Draw::~Draw()
+{
+  cancel_rendering();
+  if (cursor_tick_id_ != 0)
+    remove_tick_callback(cursor_tick_id_);
+}
+
 /**
  * \brief Adding tags.
  * See also: https://gitlab.gnome.org/GNOME/gtkmm/-/blob/master/demos/gtk-demo/example_textview.cc#L100
@@ -123,6 +144,11 @@ void Draw::add_tags()
   tmpTag = buffer->create_tag("highlight");
   tmpTag->property_foreground() = "black";
   tmpTag->property_background() = "#FFFF00";
+
+  // link (shared by all links, the URLs are stored in the link index)
+  link_tag_ = buffer->create_tag("link");
+  link_tag_->property_foreground() = "#569cd6";
+  link_tag_->property_underline() = Pango::Underline::UNDERLINE_SINGLE;
 }
 
 /**
@@ -161,13 +187,25 @@ void Draw::event_after(GdkEvent* ev)
 }
 
 /**
- * \brief Update the cursor whenever there is a link
+ * \brief Update the cursor whenever there is a link.
+ * Motion events are coalesced, the cursor is only updated once per frame for the last pointer position.
  */
 bool Draw::motion_notify_event(GdkEventMotion* motion_event)
 {
-  int x, y;
-  window_to_buffer_coords(Gtk::TextWindowType::TEXT_WINDOW_WIDGET, motion_event->x, motion_event->y, x, y);
-  this->change_cursor(x, y);
+  window_to_buffer_coords(Gtk::TextWindowType::TEXT_WINDOW_WIDGET, motion_event->x, motion_event->y, pointer_x_, pointer_y_);
+  if (cursor_tick_id_ == 0)
+    cursor_tick_id_ = add_tick_callback(sigc::mem_fun(this, &Draw::cursor_tick));
+  return false;
+}
+
+/**
+ * \brief Frame clock tick after a motion event, update the cursor for the last pointer position
+ * \return always false, the tick callback is removed again
+ */
+bool Draw::cursor_tick(const Glib::RefPtr<Gdk::FrameClock>& frame_clock __attribute__((unused)))
+{
+  cursor_tick_id_ = 0;
+  this->change_cursor(pointer_x_, pointer_y_);
   return false;
 }
 
@@ -189,21 +227,11 @@ bool Draw::query_tooltip(int x, int y, bool keyboard_tooltip, const Glib::RefPtr
     window_to_buffer_coords(Gtk::TextWindowType::TEXT_WINDOW_WIDGET, x, y, mouseX, mouseY);
     get_iter_at_location(iter, mouseX, mouseY);
   }
-  bool found = false;
-  auto tags = iter.get_tags();
-  for (auto const& tag : tags)
-  {
-    char* url = static_cast<char*>(tag->get_data("url"));
-    if (url != 0 && (strlen(url) > 0))
-    {
-      // Show link as tooltip
-      tooltip->set_markup(url);
-      found = true;
-      break;
-    }
-  }
-  if (found)
+  const std::string* url = get_link_url(iter);
+  if (url != nullptr)
   {
+    // Show link as tooltip
+    tooltip->set_markup(*url);
     return true;
   }
   else
@@ -267,11 +295,10 @@ void Draw::set_message(const Glib::ustring& message, const Glib::ustring& detail
     this->disable_edit();
   this->clear();
 
-  heading_level_ = 1;
-  this->insert_text(message);
-  heading_level_ = 0;
+  this->add_heading(message.raw(), 1);
+  this->insert_tag_text(message, "heading1");
   this->insert_markup_text("\n\n");
-  this->insert_text(details);
+  this->insert_tag_text(details, std::vector<Glib::ustring>());
 }
 
 /**
@@ -283,10 +310,10 @@ void Draw::show_homepage()
     this->disable_edit();
   this->clear();
 
-  heading_level_ = 1;
-  this->insert_text("Welcome to LibreWeb 🌍🚀");
-  heading_level_ = 0;
-  this->insert_text("\n\n");
+  Glib::ustring title = "Welcome to LibreWeb 🌍🚀";
+  this->add_heading(title.raw(), 1);
+  this->insert_tag_text(title, "heading1");
+  this->insert_tag_text("\n\n", std::vector<Glib::ustring>());
   this->insert_markup_text(
       "Welcome to the decentralized web (also known as web 3.0). Thanks for using LibreWeb!👍\n\n"
       "LibreWeb is a free &amp; open-source decentralized web browser. With LibreWeb can surf the world-wide-web as originally "
@@ -294,39 +321,354 @@ void Draw::show_homepage()
       "The content can be fully written in <i>markdown format</i>, allowing you to easily publish your own site, blog article or "
       "e-book. And markdown makes surfing the web very safe.\n"
       "This browser has even a <b>built-in editor</b>. Check it out in the menu: <tt>File->New Document</tt>!");
-  this->insert_text("\n\nSee an example page hosted on IPFS: ");
+  this->insert_tag_text("\n\nSee an example page hosted on IPFS: ", std::vector<Glib::ustring>());
   this->insert_link_text("Click here for the example page", "ipfs://QmQQQyYm8GcLBEE7H3NMQWfkyfU5yHiT5i1J98gbfDGRuX");
 }
 
 /**
- * \brief Process AST document (markdown format) and draw the text in the GTK TextView
- * The cmark_node pointer will be automatically freed for you.
- * \param root_node Markdown AST tree that will be displayed on screen
+ * \brief Draw the render document (see RenderDocument) in the GTK TextView.
+ * The first part of the document is drawn directly, the rest is drawn in time slices when idle (see render_slice()).
+ * \param document Compiled markdown document that will be displayed on screen
  */
-void Draw::set_document(cmark_node* root_node)
+void Draw::set_document(std::shared_ptr<const RenderDocument> document)
 {
   if (get_editable())
     this->disable_edit();
   this->clear();
+  queue_document(std::move(document));
+}
+
+/**
+ * \brief Update the displayed document with a new version of the document (eg. the editor preview).
+ * Only the top-level blocks that changed compared to the previous version are drawn again, the unchanged text,
+ * tags and headings before and after the changed blocks are kept (as well as the scroll position).
+ * \param document Compiled markdown document that will be displayed on screen
+ * \return Index of the first heading that changed, the headings before it are the same as before
+ */
+std::size_t Draw::update_document(std::shared_ptr<const RenderDocument> document)
+{
+  if (get_editable())
+    this->disable_edit();
+  // All blocks need to be drawn, before the document can be compared
+  render_queued(std::chrono::steady_clock::time_point::max());
+  auto buffer = get_buffer();
+
+  const std::vector<RenderBlock>& render_blocks = document->get_blocks();
+  std::vector<DocumentBlock> blocks;
+  blocks.reserve(render_blocks.size());
+  for (const RenderBlock& source : render_blocks)
+  {
+    blocks.push_back({source.fingerprint, 0, 0, static_cast<int>(source.start_line)});
+  }
+
+  // Skip the unchanged blocks at the begin and end of the document
+  std::size_t old_count = document_blocks_.size();
+  std::size_t new_count = blocks.size();
+  std::size_t prefix = 0;
+  while (prefix < old_count && prefix < new_count && document_blocks_[prefix].fingerprint == blocks[prefix].fingerprint)
+  {
+    blocks[prefix] = document_blocks_[prefix];
+    ++prefix;
+  }
+  std::size_t suffix = 0;
+  while (suffix < old_count - prefix && suffix < new_count - prefix &&
+         document_blocks_[old_count - suffix - 1].fingerprint == blocks[new_count - suffix - 1].fingerprint)
+  {
+    // Keep the drawn block, at the line of the new version
+    int start_line = blocks[new_count - suffix - 1].start_line;
+    blocks[new_count - suffix - 1] = document_blocks_[old_count - suffix - 1];
+    blocks[new_count - suffix - 1].start_line = start_line;
+    ++suffix;
+  }
+
+  int begin_offset = 0;
+  std::size_t heading_begin = 0;
+  for (std::size_t i = 0; i < prefix; ++i)
+  {
+    begin_offset += document_blocks_[i].char_count;
+    heading_begin += document_blocks_[i].heading_count;
+  }
+  int old_char_count = 0;
+  std::size_t old_heading_count = 0;
+  for (std::size_t i = prefix; i < old_count - suffix; ++i)
+  {
+    old_char_count += document_blocks_[i].char_count;
+    old_heading_count += document_blocks_[i].heading_count;
+  }
+
+  // Remove the headings of the changed blocks, keep the headings of the blocks after it aside
+  std::vector<Heading> tail_headings(headings_.begin() + heading_begin + old_heading_count, headings_.end());
+  headings_.resize(heading_begin);
+  // Same for the links
+  auto is_link_before = [](const LinkRange& link, int offset) { return link.begin_offset < offset; };
+  auto first_changed_link = std::lower_bound(links_.begin(), links_.end(), begin_offset, is_link_before);
+  auto first_tail_link = std::lower_bound(first_changed_link, links_.end(), begin_offset + old_char_count, is_link_before);
+  std::vector<LinkRange> tail_links(first_tail_link, links_.end());
+  links_.erase(first_changed_link, links_.end());
+
+  // Draw the changed blocks in front of the old version of these blocks
+  buffer->move_mark(render_mark_, buffer->get_iter_at_offset(begin_offset));
+  int new_char_count = 0;
+  for (std::size_t i = prefix; i < new_count - suffix; ++i)
+  {
+    render_block(*document, render_blocks[i], blocks[i]);
+    new_char_count += blocks[i].char_count;
+  }
+
+  // Remove the old version of the changed blocks
+  int end_offset = begin_offset + new_char_count;
+  if (old_char_count > 0)
+  {
+    buffer->erase(buffer->get_iter_at_offset(end_offset), buffer->get_iter_at_offset(end_offset + old_char_count));
+  }
+  // The blocks after the changed blocks are moved, in the text buffer as well as in the markdown source
+  int line_shift = (suffix > 0) ? blocks[new_count - suffix].start_line - document_blocks_[old_count - suffix].start_line : 0;
+  for (Heading& heading : tail_headings)
+  {
+    heading.offset += new_char_count - old_char_count;
+    if (heading.source_line > 0)
+      heading.source_line += line_shift;
+  }
+  headings_.insert(headings_.end(), tail_headings.begin(), tail_headings.end());
+  for (LinkRange& link : tail_links)
+  {
+    link.begin_offset += new_char_count - old_char_count;
+    link.end_offset += new_char_count - old_char_count;
+  }
+  links_.insert(links_.end(), tail_links.begin(), tail_links.end());
+  buffer->move_mark(render_mark_, buffer->end());
+  document_blocks_ = std::move(blocks);
+  compact_heading_titles();
+  compact_link_urls();
+  return heading_begin;
+}
+
+/**
+ * \brief Append the top-level blocks of the document to the end of the displayed document (eg. when the
+ * document is still being received). Drawn in time slices like set_document().
+ * \param document Compiled markdown document containing the next blocks of the document
+ */
+void Draw::append_document(std::shared_ptr<const RenderDocument> document)
+{
+  queue_document(std::move(document));
+}
 
-  // Loop over AST nodes
-  cmark_event_type ev_type;
-  cmark_iter* iter = cmark_iter_new(root_node);
-  while ((ev_type = cmark_iter_next(iter)) != CMARK_EVENT_DONE)
+/**
+ * \brief Add the document to the render queue, start drawing directly when no other document is being drawn
+ * \param document Compiled markdown document
+ */
+void Draw::queue_document(std::shared_ptr<const RenderDocument> document)
+{
+  render_queue_.push_back(std::move(document));
+  if (!render_idle_handler_.connected() && render_slice())
   {
-    cmark_node* cur = cmark_iter_get_node(iter);
-    try
+    // Continue drawing when idle, with a lower priority than redrawing the window and handling events
+    render_idle_handler_ = Glib::signal_idle().connect(sigc::mem_fun(this, &Draw::render_slice));
+  }
+}
+
+/**
+ * \brief Draw the queued documents for a limited amount of time, so the window stays responsive for huge documents
+ * \return true if there is still something left to draw, otherwise false
+ */
+bool Draw::render_slice()
+{
+  return render_queued(std::chrono::steady_clock::now() + RenderSliceDuration);
+}
+
+/**
+ * \brief Draw the queued documents until the deadline, operation by operation.
+ * The headings_added signal is emitted for the headings that are drawn.
+ * \param deadline Stop drawing after this point in time
+ * \return true if there is still something left to draw, otherwise false
+ */
+bool Draw::render_queued(std::chrono::steady_clock::time_point deadline)
+{
+  auto buffer = get_buffer();
+  std::size_t first_new_heading = headings_.size();
+  int op_count = 0;
+  bool is_time_up = false;
+  buffer->move_mark(render_mark_, buffer->end());
+  while (!render_queue_.empty() && !is_time_up)
+  {
+    const RenderDocument& document = *render_queue_.front();
+    const std::vector<RenderOp>& ops = document.get_ops();
+    const std::vector<RenderBlock>& blocks = document.get_blocks();
+    for (;;)
     {
-      process_node(cur, ev_type);
+      // Start of the next top-level block(s), empty blocks (eg. HTML) don't have any operations
+      while (render_block_index_ < blocks.size() && blocks[render_block_index_].first_op == render_op_index_)
+      {
+        start_render_block(blocks[render_block_index_++]);
+      }
+      if (is_time_up || render_op_index_ >= ops.size())
+        break;
+      render_op(document, ops[render_op_index_++]);
+      // Only check the time once in a while
+      is_time_up = ((++op_count % RenderOpsPerTimeCheck) == 0) && (std::chrono::steady_clock::now() >= deadline);
     }
-    catch (const std::runtime_error& error)
+    if (render_op_index_ >= ops.size())
     {
-      std::cerr << "ERROR: Processing node failed, with message: " << error.what() << std::endl;
-      // Continue nevertheless
+      // Document is completely drawn
+      finish_render_block();
+      render_queue_.pop_front();
+      render_op_index_ = 0;
+      render_block_index_ = 0;
     }
   }
-  // Clean-up the memory
-  cmark_node_free(root_node);
+  if (headings_.size() > first_new_heading)
+    headings_added.emit(first_new_heading);
+  scroll_when_drawn();
+  return !render_queue_.empty();
+}
+
+/**
+ * \brief Start drawing the next top-level block, the previous block is finished
+ * \param block Top-level block of the document
+ */
+void Draw::start_render_block(const RenderBlock& block)
+{
+  finish_render_block();
+  is_render_block_started_ = true;
+  render_block_fingerprint_ = block.fingerprint;
+  render_block_start_line_ = static_cast<int>(block.start_line);
+  render_block_char_offset_ = get_buffer()->get_char_count();
+  render_block_heading_index_ = headings_.size();
+}
+
+/**
+ * \brief Store the top-level block that is drawn last (if any), so it can be compared later on (see update_document())
+ */
+void Draw::finish_render_block()
+{
+  if (is_render_block_started_)
+  {
+    int char_count = get_buffer()->get_char_count() - render_block_char_offset_;
+    std::size_t heading_count = headings_.size() - render_block_heading_index_;
+    document_blocks_.push_back({render_block_fingerprint_, char_count, heading_count, render_block_start_line_});
+    is_render_block_started_ = false;
+  }
+}
+
+/**
+ * \brief Stop drawing the queued documents
+ */
+void Draw::cancel_rendering()
+{
+  render_idle_handler_.disconnect();
+  render_queue_.clear();
+  render_op_index_ = 0;
+  render_block_index_ = 0;
+  is_render_block_started_ = false;
+  pending_scroll_offset_ = -1;
+}
+
+/**
+ * \brief Scroll to the pending scroll position (see scroll_to_offset()), once the text at that position is drawn
+ */
+void Draw::scroll_when_drawn()
+{
+  if (pending_scroll_offset_ < 0)
+    return;
+  auto buffer = get_buffer();
+  if (buffer->get_char_count() > pending_scroll_offset_ || render_queue_.empty())
+  {
+    buffer->move_mark(scroll_mark_, buffer->get_iter_at_offset(pending_scroll_offset_));
+    // Scrolling to a mark waits until the lines are laid out
+    scroll_to(scroll_mark_, 0.0, 0.0, 0.0);
+    pending_scroll_offset_ = -1;
+  }
+}
+
+/**
+ * \brief Draw a top-level block at the render position, and count the inserted characters and headings
+ * \param document Compiled markdown document
+ * \param source Top-level block of the document
+ * \param block Block information that gets updated
+ */
+void Draw::render_block(const RenderDocument& document, const RenderBlock& source, DocumentBlock& block)
+{
+  auto buffer = get_buffer();
+  int char_count = buffer->get_char_count();
+  std::size_t heading_count = headings_.size();
+  const std::vector<RenderOp>& ops = document.get_ops();
+  for (std::size_t i = source.first_op; i < source.first_op + source.op_count; ++i)
+  {
+    render_op(document, ops[i]);
+  }
+  block.char_count = buffer->get_char_count() - char_count;
+  block.heading_count = headings_.size() - heading_count;
+}
+
+/**
+ * \brief Execute a single drawing operation at the render position
+ * \param document Compiled markdown document, containing the text of the operation
+ * \param op Drawing operation
+ */
+void Draw::render_op(const RenderDocument& document, const RenderOp& op)
+{
+  auto buffer = get_buffer();
+  const char* text = document.get_text(op);
+  switch (op.type)
+  {
+  case RenderOp::OP_TEXT:
+    if (op.format == FORMAT_NONE)
+      buffer->insert(get_render_iter(), text, text + op.text_length);
+    else
+      buffer->insert_with_tags(get_render_iter(), text, text + op.text_length, get_tag_set(op.format));
+    break;
+  case RenderOp::OP_LINK:
+    insert_link_text(Glib::ustring(text, text + op.text_length), document.get_link(op));
+    break;
+  case RenderOp::OP_HEADING:
+    add_heading(std::string(text, op.text_length), op.heading_level, static_cast<int>(op.source_line));
+    break;
+  }
+}
+
+/**
+ * \brief Get the text tags for the text formatting flags. The tags are looked-up once for each combination of flags,
+ * and reused for all the next documents.
+ * \param format Text formatting flags (see TextFormat)
+ * \return Text tags
+ */
+const std::vector<Glib::RefPtr<Gtk::TextTag>>& Draw::get_tag_set(std::uint16_t format)
+{
+  auto tag_set = tag_sets_.find(format);
+  if (tag_set != tag_sets_.end())
+    return tag_set->second;
+
+  static const char* const heading_tag_names[] = {"heading1", "heading2", "heading3", "heading4", "heading5", "heading6"};
+  std::vector<const char*> tag_names;
+  if (format & FORMAT_STRIKETHROUGH)
+    tag_names.push_back("strikethrough");
+  if (format & FORMAT_SUPERSCRIPT)
+    tag_names.push_back("superscript");
+  if (format & FORMAT_SUBSCRIPT)
+    tag_names.push_back("subscript");
+  if (format & FORMAT_BOLD)
+    tag_names.push_back("bold");
+  if (format & FORMAT_ITALIC)
+    tag_names.push_back("italic");
+  if (format & FORMAT_HIGHLIGHT)
+    tag_names.push_back("highlight");
+  if (format & FORMAT_CODE)
+    tag_names.push_back("code");
+  int heading_level = (format & FORMAT_HEADING_MASK) >> FORMAT_HEADING_SHIFT;
+  if (heading_level >= 1 && heading_level <= 6)
+    tag_names.push_back(heading_tag_names[heading_level - 1]);
+  if (format & FORMAT_QUOTE)
+    tag_names.push_back("quote");
+
+  auto tag_table = get_buffer()->get_tag_table();
+  std::vector<Glib::RefPtr<Gtk::TextTag>> tags;
+  for (const char* tag_name : tag_names)
+  {
+    Glib::RefPtr<Gtk::TextTag> tag = tag_table->lookup(tag_name);
+    if (tag)
+      tags.push_back(tag);
+  }
+  return tag_sets_.emplace(format, std::move(tags)).first->second;
 }
 
 void Draw::set_view_source_menu_item(bool is_enabled)
@@ -339,8 +681,7 @@ void Draw::set_view_source_menu_item(bool is_enabled)
  */
 void Draw::new_document()
 {
-  undo_pool_.clear();
-  redo_pool_.clear();
+  undo_history_.clear();
   this->clear();
 
   // Set margins to defaults in editor mode
@@ -365,11 +706,15 @@ Glib::ustring Draw::get_text() const
 
 /**
  * \brief Set text in text buffer (for example plain text)
- * \param text Text string
+ * \param text Text string (UTF-8), directly copied into the text buffer
  */
-void Draw::set_text(const Glib::ustring& text)
+void Draw::set_text(const std::string& text)
 {
-  get_buffer()->set_text(text);
+  cancel_rendering();
+  document_blocks_.clear();
+  clear_links();
+  clear_headings();
+  get_buffer()->set_text(text.data(), text.data() + text.size());
 }
 
 /**
@@ -377,13 +722,12 @@ void Draw::set_text(const Glib::ustring& text)
  */
 void Draw::clear()
 {
+  cancel_rendering();
   auto buffer = get_buffer();
   buffer->erase(buffer->begin(), buffer->end());
-  for (const Glib::RefPtr<Gtk::TextMark>& mark : headings_toc_)
-  {
-    buffer->delete_mark(mark);
-  }
-  headings_toc_.clear();
+  document_blocks_.clear();
+  clear_links();
+  clear_headings();
 }
 
 /**
@@ -391,25 +735,27 @@ void Draw::clear()
  */
 void Draw::undo()
 {
-  if (get_editable() && (undo_pool_.size() > 0))
+  if (!get_editable())
+    return;
+  const std::vector<UndoEdit>* edits = undo_history_.undo();
+  if (edits != nullptr)
   {
-    auto undoAction = undo_pool_.at(undo_pool_.size() - 1);
     auto buffer = get_buffer();
-    undo_pool_.pop_back();
-    if (undoAction.is_insert)
-    {
-      Gtk::TextBuffer::iterator startIter = buffer->get_iter_at_offset(undoAction.begin_offset);
-      Gtk::TextBuffer::iterator end_iter = buffer->get_iter_at_offset(undoAction.end_offset);
-      buffer->erase(startIter, end_iter);
-      buffer->place_cursor(buffer->get_iter_at_offset(undoAction.begin_offset));
-    }
-    else
+    // Revert the edits of the undo step in reverse order
+    for (auto edit = edits->rbegin(); edit != edits->rend(); ++edit)
     {
-      Gtk::TextBuffer::iterator startIter = buffer->get_iter_at_offset(undoAction.begin_offset);
-      buffer->insert(startIter, undoAction.text);
-      buffer->place_cursor(buffer->get_iter_at_offset(undoAction.end_offset));
+      if (edit->is_insert)
+      {
+        buffer->erase(buffer->get_iter_at_offset(edit->begin_offset), buffer->get_iter_at_offset(edit->end_offset));
+        buffer->place_cursor(buffer->get_iter_at_offset(edit->begin_offset));
+      }
+      else
+      {
+        const char* text = undo_history_.get_text(*edit);
+        buffer->insert(buffer->get_iter_at_offset(edit->begin_offset), text, text + edit->text_length);
+        buffer->place_cursor(buffer->get_iter_at_offset(edit->end_offset));
+      }
     }
-    redo_pool_.push_back(undoAction);
   }
 }
 
@@ -418,28 +764,47 @@ void Draw::undo()
  */
 void Draw::redo()
 {
-  if (get_editable() && (redo_pool_.size() > 0))
+  if (!get_editable())
+    return;
+  const std::vector<UndoEdit>* edits = undo_history_.redo();
+  if (edits != nullptr)
   {
-    auto redoAction = redo_pool_.at(redo_pool_.size() - 1);
     auto buffer = get_buffer();
-    redo_pool_.pop_back();
-    if (redoAction.is_insert)
-    {
-      Gtk::TextBuffer::iterator startIter = buffer->get_iter_at_offset(redoAction.begin_offset);
-      buffer->insert(startIter, redoAction.text);
-      buffer->place_cursor(buffer->get_iter_at_offset(redoAction.end_offset));
-    }
-    else
+    for (const UndoEdit& edit : *edits)
     {
-      Gtk::TextBuffer::iterator startIter = buffer->get_iter_at_offset(redoAction.begin_offset);
-      Gtk::TextBuffer::iterator end_iter = buffer->get_iter_at_offset(redoAction.end_offset);
-      buffer->erase(startIter, end_iter);
-      buffer->place_cursor(buffer->get_iter_at_offset(redoAction.begin_offset));
+      if (edit.is_insert)
+      {
+        const char* text = undo_history_.get_text(edit);
+        buffer->insert(buffer->get_iter_at_offset(edit.begin_offset), text, text + edit.text_length);
+        buffer->place_cursor(buffer->get_iter_at_offset(edit.end_offset));
+      }
+      else
+      {
+        buffer->erase(buffer->get_iter_at_offset(edit.begin_offset), buffer->get_iter_at_offset(edit.end_offset));
+        buffer->place_cursor(buffer->get_iter_at_offset(edit.begin_offset));
+      }
     }
-    undo_pool_.push_back(redoAction);
   }
 }
 
+/**
+ * \brief Set the memory limit of the undo/redo history, the oldest undo steps are dropped when needed
+ * \param max_bytes Memory limit in bytes
+ */
+void Draw::set_undo_history_limit(std::size_t max_bytes)
+{
+  undo_history_.set_max_bytes(max_bytes);
+}
+
+/**
+ * \brief Get the memory footprint of the undo/redo history
+ * \return Number of bytes
+ */
+std::size_t Draw::get_undo_history_memory_usage() const
+{
+  return undo_history_.get_memory_usage();
+}
+
 /**
  * \brief Cut text into clipboard
  */
@@ -511,11 +876,46 @@ void Draw::select_all()
 }
 
 /**
- * \brief Return the Texr mark headings for Table of contents
+ * \brief Return the headings for Table of contents, in document order
+ */
+const std::vector<Heading>& Draw::get_headings() const
+{
+  return headings_;
+}
+
+/**
+ * \brief Get the scroll position, as the character offset of the first visible line
+ * \return Character offset
+ */
+int Draw::get_scroll_offset()
+{
+  Gdk::Rectangle visible_rect;
+  get_visible_rect(visible_rect);
+  Gtk::TextBuffer::iterator iter;
+  int line_top;
+  get_line_at_y(iter, visible_rect.get_y(), line_top);
+  return iter.get_offset();
+}
+
+/**
+ * \brief Scroll to the line containing the character offset (see get_scroll_offset()). When the document is
+ * still being drawn, it scrolls as soon as the line is drawn.
+ * \param offset Character offset
+ */
+void Draw::scroll_to_offset(int offset)
+{
+  pending_scroll_offset_ = offset;
+  scroll_when_drawn();
+}
+
+/**
+ * \brief Return the title of the heading
+ * \param heading Heading of this text view (see get_headings())
+ * \return Heading title
  */
-const std::vector<Glib::RefPtr<Gtk::TextMark>>& Draw::get_headings() const
+const std::string& Draw::get_heading_title(const Heading& heading) const
 {
-  return headings_toc_;
+  return heading_titles_.at(heading.title);
 }
 
 /*************************************************************
@@ -1019,11 +1419,13 @@ void Draw::make_highlight()
 void Draw::begin_user_action()
 {
   is_user_action_ = true;
+  undo_history_.begin_action();
 }
 
 void Draw::end_user_action()
 {
   is_user_action_ = false;
+  undo_history_.end_action();
 }
 
 /**
@@ -1033,13 +1435,7 @@ void Draw::on_insert(const Gtk::TextBuffer::iterator& pos, const Glib::ustring&
 {
   if (is_user_action_)
   {
-    UndoRedoData undoData = {};
-    undoData.is_insert = true;
-    undoData.begin_offset = pos.get_offset();
-    undoData.end_offset = pos.get_offset() + text.size();
-    undoData.text = text;
-    undo_pool_.push_back(undoData);
-    redo_pool_.clear();
+    undo_history_.add_insert(pos.get_offset(), text.raw(), static_cast<int>(text.size()));
   }
 }
 
@@ -1051,12 +1447,7 @@ void Draw::on_delete(const Gtk::TextBuffer::iterator& range_start, const Gtk::Te
   if (is_user_action_)
   {
     auto text = get_buffer()->get_text(range_start, range_end);
-    UndoRedoData undoData = {};
-    undoData.is_insert = false;
-    undoData.begin_offset = range_start.get_offset();
-    undoData.end_offset = range_end.get_offset();
-    undoData.text = text;
-    undo_pool_.push_back(undoData);
+    undo_history_.add_delete(range_start.get_offset(), range_end.get_offset(), text.raw());
   }
 }
 
@@ -1068,6 +1459,11 @@ void Draw::enable_edit()
 {
   set_editable(true);
   set_cursor_visible(true);
+  // The text will be changed by the user, the rendered document blocks are no longer valid
+  cancel_rendering();
+  document_blocks_.clear();
+  clear_links();
+  clear_headings();
   auto buffer = get_buffer();
   this->begin_user_action_signal_handler = buffer->signal_begin_user_action().connect(sigc::mem_fun(this, &Draw::begin_user_action), false);
   this->end_user_action_signal_handler = buffer->signal_end_user_action().connect(sigc::mem_fun(this, &Draw::end_user_action), false);
@@ -1091,458 +1487,127 @@ void Draw::disable_edit()
  */
 void Draw::follow_link(Gtk::TextBuffer::iterator& iter)
 {
-  auto tags = iter.get_tags();
-  for (auto const& tag : tags)
+  const std::string* url = get_link_url(iter);
+  if (url != nullptr)
   {
-    char* url = static_cast<char*>(tag->get_data("url"));
-    if (url != 0 && (strlen(url) > 0))
-    {
-      // Got to URL
-      middleware_.do_request(url);
-      break;
-    }
+    // Got to URL
+    middleware_.do_request(*url);
   }
 }
 
 /**
- * Process and parse each node in the AST
+ * \brief Find the link at the position, using a binary search in the link index.
+ * The links are sorted by offset and do not overlap.
+ * \param iter Position in the text buffer
+ * \return Pointer to the link URL, or nullptr when there is no link at this position
  */
-void Draw::process_node(cmark_node* node, cmark_event_type ev_type)
+const std::string* Draw::get_link_url(const Gtk::TextBuffer::iterator& iter) const
 {
-  bool entering = (ev_type == CMARK_EVENT_ENTER);
-
-  // Take care of the markdown extensions
-  if (node->extension)
-  {
-    if (strcmp(node->extension->name, "strikethrough") == 0)
-    {
-      is_strikethrough_ = entering;
-      return;
-    }
-    else if (strcmp(node->extension->name, "highlight") == 0)
-    {
-      is_highlight_ = entering;
-      return;
-    }
-    else if (strcmp(node->extension->name, "superscript") == 0)
-    {
-      is_superscript_ = entering;
-      return;
-    }
-    else if (strcmp(node->extension->name, "subscript") == 0)
-    {
-      is_subscript_ = entering;
-      return;
-    }
-  }
-
-  switch (node->type)
-  {
-  case CMARK_NODE_DOCUMENT:
-    if (entering)
-    {
-      // Reset all (better safe than sorry)
-      heading_level_ = 0;
-      bullet_list_level_ = 0;
-      ordered_list_level_ = 0;
-      list_level_ = 0;
-      is_ordered_list_ = false;
-      is_bold_ = false;
-      is_italic_ = false;
-      is_strikethrough_ = false;
-      is_highlight_ = false;
-      is_superscript_ = false;
-      is_subscript_ = false;
-      is_quote_ = false;
-    }
-    break;
-
-  case CMARK_NODE_BLOCK_QUOTE:
-    is_quote_ = entering;
-    if (!entering)
-    {
-      // Replace last quote '|'-sign with a normal blank line
-      this->truncate_text(2);
-      this->insert_markup_text("\n");
-    }
-    break;
-
-  case CMARK_NODE_LIST:
-  {
-    cmark_list_type listType = node->as.list.list_type;
-
-    if (entering)
-    {
-      list_level_++;
-    }
-    else
-    {
-      list_level_--;
-    }
-    if (list_level_ == 0)
-    {
-      // Reset bullet/ordered levels
-      bullet_list_level_ = 0;
-      ordered_list_level_ = 0;
-      is_ordered_list_ = false;
-      if (!entering)
-        this->insert_markup_text("\n");
-    }
-    else if (list_level_ > 0)
-    {
-      if (entering)
-      {
-        if (listType == cmark_list_type::CMARK_BULLET_LIST)
-        {
-          bullet_list_level_++;
-        }
-        else if (listType == cmark_list_type::CMARK_ORDERED_LIST)
-        {
-          ordered_list_level_++;
-          // Create the counter (and reset to zero)
-          ordered_list_counters[ordered_list_level_] = 0;
-        }
-      }
-      else
-      {
-        // Un-indent list level again
-        if (listType == cmark_list_type::CMARK_BULLET_LIST)
-        {
-          bullet_list_level_--;
-        }
-        else if (listType == cmark_list_type::CMARK_ORDERED_LIST)
-        {
-          ordered_list_level_--;
-        }
-      }
-
-      is_ordered_list_ = (ordered_list_level_ > 0) && (bullet_list_level_ <= 0);
-    }
-  }
-  break;
-
-  case CMARK_NODE_ITEM:
-    if (entering)
-    {
-      if (is_ordered_list_)
-      {
-        // Increasement ordered list counter
-        ordered_list_counters[ordered_list_level_]++;
-      }
-
-      // Insert tabs & bullet/number
-      if (bullet_list_level_ > 0)
-      {
-        if (bullet_list_level_ % 2 == 0)
-        {
-          this->insert_text(Glib::ustring(bullet_list_level_, '\u0009') + "\u25e6 ");
-        }
-        else
-        {
-          this->insert_text(Glib::ustring(bullet_list_level_, '\u0009') + "\u2022 ");
-        }
-      }
-      else if (ordered_list_level_ > 0)
-      {
-        Glib::ustring number;
-        if (ordered_list_level_ % 2 == 0)
-        {
-          number = Draw::int_to_roman(ordered_list_counters[ordered_list_level_]) + " ";
-        }
-        else
-        {
-          number = std::to_string(ordered_list_counters[ordered_list_level_]) + ". ";
-        }
-        this->insert_text(Glib::ustring(ordered_list_level_, '\u0009') + number);
-      }
-    }
-    break;
-
-  case CMARK_NODE_HEADING:
-    if (entering)
-    {
-      heading_level_ = node->as.heading.level;
-    }
-    else
-    {
-      // Insert line break after heading
-      this->insert_markup_text("\n\n");
-      heading_level_ = 0; // reset
-    }
-    break;
-
-  case CMARK_NODE_CODE_BLOCK:
-  {
-    Glib::ustring code = cmark_node_get_literal(node);
-    Glib::ustring newline = (is_quote_) ? "" : "\n";
-    this->insert_text(code + newline, "", CodeTypeEnum::CODE_TYPE_CODE_BLOCK);
-  }
-  break;
-
-  case CMARK_NODE_HTML_BLOCK:
-    break;
-
-  case CMARK_NODE_CUSTOM_BLOCK:
-    break;
-
-  case CMARK_NODE_THEMATIC_BREAK:
-  {
-    is_bold_ = true;
-    this->insert_text("\u2015\u2015\u2015\u2015\u2015\u2015\u2015\u2015\u2015\u2015\u2015\u2015\u2015\u2015\u2015"
-                      "\u2015\u2015\u2015\u2015\u2015\u2015\u2015\u2015\u2015\n\n");
-    is_bold_ = false;
-  }
-  break;
-
-  case CMARK_NODE_PARAGRAPH:
-    // For listings only insert a single new line
-    if (!entering && (list_level_ > 0))
-    {
-      this->insert_markup_text("\n");
-    }
-    // Dealing with paragraphs in quotes
-    else if (entering && is_quote_)
-    {
-      this->insert_text("\uFF5C ");
-    }
-    else if (!entering && is_quote_)
-    {
-      this->insert_text("\n\uFF5C\n");
-    }
-    // Normal paragraph, just blank line
-    else if (!entering)
-    {
-      this->insert_markup_text("\n\n");
-    }
-    break;
-
-  case CMARK_NODE_TEXT:
-  {
-    Glib::ustring text = cmark_node_get_literal(node);
-    // URL
-    if (is_link)
-    {
-      this->insert_text(text, link_url_);
-      link_url_ = "";
-    }
-    // Text (with optional inline formatting)
-    else
-    {
-      this->insert_text(text);
-    }
-  }
-  break;
-
-  case CMARK_NODE_LINEBREAK:
-    // Hard brake
-    this->insert_markup_text("\n");
-    break;
-
-  case CMARK_NODE_SOFTBREAK:
-    // only insert space
-    this->insert_markup_text(" ");
-    break;
-
-  case CMARK_NODE_CODE:
-  {
-    Glib::ustring code = cmark_node_get_literal(node);
-    this->insert_text(code, "", CodeTypeEnum::CODE_TYPE_INLINE_CODE);
-  }
-  break;
-
-  case CMARK_NODE_HTML_INLINE:
-    break;
-
-  case CMARK_NODE_CUSTOM_INLINE:
-    break;
-
-  case CMARK_NODE_STRONG:
-    is_bold_ = entering;
-    break;
-
-  case CMARK_NODE_EMPH:
-    is_italic_ = entering;
-    break;
-
-  case CMARK_NODE_LINK:
-    is_link = entering;
-    if (entering)
-    {
-      link_url_ = cmark_node_get_url(node);
-    }
-    break;
-
-  case CMARK_NODE_IMAGE:
-    break;
-
-  case CMARK_NODE_FOOTNOTE_REFERENCE:
-    break;
-
-  case CMARK_NODE_FOOTNOTE_DEFINITION:
-    break;
-  default:
-    throw std::runtime_error("Node type '" + Glib::ustring(cmark_node_get_type_string(node)) + "' not found.");
-    break;
-  }
+  int offset = iter.get_offset();
+  // First link that starts after the position, the link in front of it might contain the position
+  auto link = std::upper_bound(links_.begin(), links_.end(), offset,
+                               [](int position, const LinkRange& range) { return position < range.begin_offset; });
+  if (link != links_.begin() && offset < std::prev(link)->end_offset)
+    return &link_urls_[std::prev(link)->url];
+  return nullptr;
 }
 
-/******************************************************
- * Helper functions below
- *****************************************************/
 /**
- * Encode text string (eg. ampersand-character)
- * @param[in/out] string
+ * \brief Remove all links from the link index (the text itself is not changed)
  */
-void Draw::encode_text(std::string& string) const
+void Draw::clear_links()
 {
-  std::string buffer;
-  buffer.reserve(string.size() + 5);
-  for (size_t pos = 0; pos != string.size(); ++pos)
-  {
-    switch (string[pos])
-    {
-    case '&':
-      buffer.append("&amp;");
-      break;
-    default:
-      buffer.append(&string[pos], 1);
-      break;
-    }
-  }
-  string.swap(buffer);
+  links_.clear();
+  link_urls_.clear();
+  link_url_ids_.clear();
 }
 
 /**
- * Insert markup text (markup only works if you first parsed the text, otherwise use the insert_markup_text method)
+ * \brief Remove all headings and heading titles (the text itself is not changed)
  */
-void Draw::insert_text(std::string text, const Glib::ustring& url, CodeTypeEnum code_type)
+void Draw::clear_headings()
 {
-  std::vector<Glib::ustring> tag_names;
-
-  // Use by reference to replace the string
-  // TODO: For normal text, you want to bring back the '&amp;' to '&' symbol again
-  this->encode_text(text);
+  headings_.clear();
+  heading_titles_.clear();
+  heading_title_ids_.clear();
+}
 
-  if (is_strikethrough_)
-  {
-    tag_names.push_back("strikethrough");
-  }
-  if (is_superscript_)
-  {
-    tag_names.push_back("superscript");
-  }
-  // You can not have superscript & subscript applied together
-  else if (is_subscript_)
-  {
-    tag_names.push_back("subscript");
-  }
-  if (is_bold_)
-  {
-    tag_names.push_back("bold");
-  }
-  if (is_italic_)
-  {
-    tag_names.push_back("italic");
-  }
-  if (is_highlight_)
-  {
-    tag_names.push_back("highlight");
-  }
-  if (code_type != Draw::CodeTypeEnum::CODE_TYPE_NONE)
-  {
-    tag_names.push_back("code");
-  }
-  if (heading_level_ > 0)
-  {
-    switch (heading_level_)
+/**
+ * \brief Drop the heading titles that are no longer used, once there are much more titles than headings
+ * (eg. after a lot of updates by the editor).
+ */
+void Draw::compact_heading_titles()
+{
+  if (heading_titles_.size() <= 2 * headings_.size() + HeadingTitlesSpare)
+    return;
+  const std::uint32_t unused = std::numeric_limits<std::uint32_t>::max();
+  std::vector<std::uint32_t> new_ids(heading_titles_.size(), unused);
+  std::vector<std::string> titles;
+  heading_title_ids_.clear();
+  for (Heading& heading : headings_)
+  {
+    std::uint32_t& new_id = new_ids[heading.title];
+    if (new_id == unused)
     {
-    case 1:
-      tag_names.push_back("heading1");
-      break;
-    case 2:
-      tag_names.push_back("heading2");
-      break;
-    case 3:
-      tag_names.push_back("heading3");
-      break;
-    case 4:
-      tag_names.push_back("heading4");
-      break;
-    case 5:
-      tag_names.push_back("heading5");
-      break;
-    case 6:
-      tag_names.push_back("heading6");
-      break;
-    default:
-      break;
+      new_id = static_cast<std::uint32_t>(titles.size());
+      titles.push_back(std::move(heading_titles_[heading.title]));
+      heading_title_ids_.emplace(titles.back(), new_id);
     }
-    // Already add the mark for the heading
-    add_heading_mark(text, heading_level_);
-  }
-  if (is_quote_)
-  {
-    tag_names.push_back("quote");
+    heading.title = new_id;
   }
+  heading_titles_ = std::move(titles);
+}
 
-  // Insert text (+ headings)
-  if (url.empty())
-  {
-    // Special case for code blocks within quote
-    if ((code_type == Draw::CodeTypeEnum::CODE_TYPE_CODE_BLOCK) && is_quote_)
-    {
-      std::istringstream iss(text);
-      std::string line;
-      // Add a quote for each new code line
-      while (getline(iss, line))
-      {
-        insert_tag_text("\uFF5C ", "quote");
-        insert_tag_text(line + "\n", tag_names);
-      }
-      insert_tag_text("\uFF5C\n", "quote");
-    }
-    // Special case for heading within quote
-    else if ((heading_level_ > 0) && is_quote_)
-    {
-      insert_tag_text("\uFF5C ", "quote");
-      insert_tag_text(text, tag_names);
-    }
-    else
+/**
+ * \brief Drop the link URLs that are no longer used, once there are much more URLs than links
+ * (eg. after a lot of updates by the editor).
+ */
+void Draw::compact_link_urls()
+{
+  if (link_urls_.size() <= 2 * links_.size() + LinkUrlsSpare)
+    return;
+  const std::uint32_t unused = std::numeric_limits<std::uint32_t>::max();
+  std::vector<std::uint32_t> new_ids(link_urls_.size(), unused);
+  std::vector<std::string> urls;
+  link_url_ids_.clear();
+  for (LinkRange& link : links_)
+  {
+    std::uint32_t& new_id = new_ids[link.url];
+    if (new_id == unused)
     {
-      // Just insert text (default) - which includes headings as well
-      insert_tag_text(text, tag_names);
+      new_id = static_cast<std::uint32_t>(urls.size());
+      urls.push_back(std::move(link_urls_[link.url]));
+      link_url_ids_.emplace(urls.back(), new_id);
     }
+    link.url = new_id;
   }
-  // Insert URL to text
-  else
-  {
-    insert_link_text(text, url);
-  }
+  link_urls_ = std::move(urls);
 }
 
+/******************************************************
+ * Helper functions below
+ *****************************************************/
 /**
  * Insert pango text with multiple tags
  */
 void Draw::insert_tag_text(const Glib::ustring& text, std::vector<Glib::ustring> const& tag_names)
 {
   auto buffer = get_buffer();
-  auto end_iter = buffer->end();
-  buffer->insert_with_tags_by_name(end_iter, text, tag_names);
+  buffer->insert_with_tags_by_name(get_render_iter(), text, tag_names);
 }
 
 /**
- * \brief Add mark for heading (ToC)
+ * \brief Add heading (ToC) at the render position, headings with the same title share the same title index
+ * \param title Heading title
+ * \param heading_level Heading level (1-6)
+ * \param source_line Line number in the markdown source, 0 if unknown
  */
-void Draw::add_heading_mark(const Glib::ustring& text, int heading_level)
+void Draw::add_heading(const std::string& title, int heading_level, int source_line)
 {
-  auto buffer = get_buffer();
-  auto end_iter = buffer->end();
-  // Make anonymous marks, to avoid existing naming conflicts
-  Glib::RefPtr<Gtk::TextMark> textMark = Gtk::TextMark::create();
-  textMark->set_data("name", g_strdup(text.c_str()));
-  textMark->set_data("level", reinterpret_cast<void*>(static_cast<intptr_t>(heading_level)));
-  buffer->add_mark(textMark, end_iter);
-  headings_toc_.push_back(textMark);
+  auto result = heading_title_ids_.try_emplace(title, static_cast<std::uint32_t>(heading_titles_.size()));
+  if (result.second)
+    heading_titles_.push_back(title);
+  headings_.push_back({heading_level, get_render_iter().get_offset(), source_line, result.first->second});
 }
 
 /**
@@ -1551,8 +1616,7 @@ void Draw::add_heading_mark(const Glib::ustring& text, int heading_level)
 void Draw::insert_tag_text(const Glib::ustring& text, const Glib::ustring& tag_name)
 {
   auto buffer = get_buffer();
-  auto end_iter = buffer->end();
-  buffer->insert_with_tag(end_iter, text, tag_name);
+  buffer->insert_with_tag(get_render_iter(), text, tag_name);
 }
 
 /**
@@ -1561,40 +1625,35 @@ void Draw::insert_tag_text(const Glib::ustring& text, const Glib::ustring& tag_n
 void Draw::insert_markup_text(const Glib::ustring& text)
 {
   auto buffer = get_buffer();
-  auto end_iter = buffer->end();
-  buffer->insert_markup(end_iter, text);
+  buffer->insert_markup(get_render_iter(), text);
 }
 
 /**
  * Insert url link
  */
-void Draw::insert_link_text(const Glib::ustring& text, const Glib::ustring& url)
+void Draw::insert_link_text(const Glib::ustring& text, const std::string& url)
 {
   auto buffer = get_buffer();
-  auto end_iter = buffer->end();
-  auto tag = buffer->create_tag();
-  // TODO: Create a tag name with name "url" and reuse tag if possible.
-  tag->property_foreground() = "#569cd6";
-  tag->property_underline() = Pango::Underline::UNDERLINE_SINGLE;
-  tag->set_data("url", g_strdup(url.c_str()));
-  buffer->insert_with_tag(end_iter, text, tag);
+  auto result = link_url_ids_.try_emplace(url, static_cast<std::uint32_t>(link_urls_.size()));
+  if (result.second)
+    link_urls_.push_back(url);
+  int begin_offset = get_render_iter().get_offset();
+  buffer->insert_with_tag(get_render_iter(), text, link_tag_);
+  // The render mark moves along with the inserted text
+  links_.push_back({begin_offset, get_render_iter().get_offset(), result.first->second});
 }
 
 /**
- * Remove nr. chars from the end of the text buffer
+ * Get the position where the document is rendered (by default the end of the text buffer)
  */
-void Draw::truncate_text(int charsTruncated)
+Gtk::TextBuffer::iterator Draw::get_render_iter()
 {
-  auto buffer = get_buffer();
-  auto end_iter = buffer->end();
-  auto begin_iter = end_iter;
-  begin_iter.backward_chars(charsTruncated);
-  buffer->erase(begin_iter, end_iter);
+  return get_buffer()->get_iter_at_mark(render_mark_);
 }
 
 /**
- *  Looks at all tags covering the position (x, y) in the text view,
- * and if one of them is a link, change the cursor to the "hands" cursor
+ *  Looks at the link index for the position (x, y) in the text view,
+ * and if there is a link, change the cursor to the "hands" cursor
  * typically used by web browsers.
  */
 void Draw::change_cursor(int x, int y)
@@ -1603,17 +1662,7 @@ void Draw::change_cursor(int x, int y)
   bool hovering = false;
 
   get_iter_at_location(iter, x, y);
-  auto tags = iter.get_tags();
-  for (auto const& tag : tags)
-  {
-    const char* url = static_cast<char*>(tag->get_data("url"));
-    if (url != 0 && (strlen(url) > 0))
-    {
-      // Link
-      hovering = true;
-      break;
-    }
-  }
+  hovering = (get_link_url(iter) != nullptr);
 
   if (hovering != hoving_over_link_)
   {
@@ -1625,22 +1674,3 @@ void Draw::change_cursor(int x, int y)
       window->set_cursor(normal_cursor_);
   }
 }
-
-/**
- * Convert number to roman numerals
- */
-Glib::ustring Draw::int_to_roman(int num)
-{
-  static const int values[] = {1000, 900, 500, 400, 100, 90, 50, 40, 10, 9, 5, 4, 1};
-  static const Glib::ustring numerals[] = {"M", "CM", "D", "CD", "C", "XC", "L", "XL", "X", "IX", "V", "IV", "I"};
-  Glib::ustring res;
-  for (int i = 0; i < 13; ++i)
-  {
-    while (num >= values[i])
-    {
-      num -= values[i];
-      res += numerals[i];
-    }
-  }
-  return res;
-}
@@ -1,25 +1,56 @@
 #ifndef DRAW_H
 #define DRAW_H
 
-#include <cmark-gfm.h>
+#include "render-document.h"
+#include "undo-history.h"
+#include <chrono>
+#include <cstdint>
+#include <deque>
 #include <gdkmm/cursor.h>
+#include <gdkmm/frameclock.h>
 #include <gtkmm/menu.h>
 #include <gtkmm/textview.h>
 #include <gtkmm/tooltip.h>
+#include <memory>
 #include <pangomm/layout.h>
+#include <string>
+#include <unordered_map>
 
 class MiddlewareInterface;
 
 /**
- * \struct UndoRedoData
- * \brief Data structure for undo/redo text
+ * \struct DocumentBlock
+ * \brief Rendered top-level block of the document, used to only redraw the changed blocks
  */
-struct UndoRedoData
+struct DocumentBlock
 {
-  bool is_insert;
-  Glib::ustring text;
-  int begin_offset;
-  int end_offset;
+  std::uint64_t fingerprint;
+  int char_count;
+  std::size_t heading_count;
+  int start_line;
+};
+
+/**
+ * \struct LinkRange
+ * \brief Link in the text buffer, the character range refers to the link URL
+ */
+struct LinkRange
+{
+  int begin_offset;  /* Character offset of the first character */
+  int end_offset;    /* Character offset after the last character */
+  std::uint32_t url; /* Index of the link URL */
+};
+
+/**
+ * \struct Heading
+ * \brief Heading in the text buffer, used for the table of contents
+ */
+struct Heading
+{
+  int level;           /* Heading level (1-6) */
+  int offset;          /* Character offset in the text buffer */
+  int source_line;     /* Line number in the markdown source, 0 if unknown */
+  std::uint32_t title; /* Index of the heading title (see Draw::get_heading_title()) */
 };
 
 /**
@@ -30,21 +61,19 @@ class Draw : public Gtk::TextView
 {
 public:
   sigc::signal<void> source_code;
-  enum CodeTypeEnum
-  {
-    CODE_TYPE_NONE = 0,
-    CODE_TYPE_INLINE_CODE,
-    CODE_TYPE_CODE_BLOCK
-  };
+  sigc::signal<void, std::size_t> headings_added;
 
   explicit Draw(MiddlewareInterface& middleware);
+  virtual ~Draw() override;
   void set_message(const Glib::ustring& message, const Glib::ustring& details = "");
   void show_homepage();
-  void set_document(cmark_node* root_node);
+  void set_document(std::shared_ptr<const RenderDocument> document);
+  std::size_t update_document(std::shared_ptr<const RenderDocument> document);
+  void append_document(std::shared_ptr<const RenderDocument> document);
   void set_view_source_menu_item(bool is_enabled);
   void new_document();
   Glib::ustring get_text() const;
-  void set_text(const Glib::ustring& text);
+  void set_text(const std::string& text);
   void clear();
   void undo();
   void redo();
@@ -53,7 +82,12 @@ public:
   void paste();
   void del();
   void select_all();
-  const std::vector<Glib::RefPtr<Gtk::TextMark>>& get_headings() const;
+  void set_undo_history_limit(std::size_t max_bytes);
+  std::size_t get_undo_history_memory_usage() const;
+  const std::vector<Heading>& get_headings() const;
+  int get_scroll_offset();
+  void scroll_to_offset(int offset);
+  const std::string& get_heading_title(const Heading& heading) const;
 
   // Signals editor calls
   void make_heading(int heading_level);
@@ -78,36 +112,44 @@ protected:
   // Signals
   void event_after(GdkEvent* ev);
   bool motion_notify_event(GdkEventMotion* motion_event);
+  bool cursor_tick(const Glib::RefPtr<Gdk::FrameClock>& frame_clock);
   bool query_tooltip(int x, int y, bool keyboard_tooltip, const Glib::RefPtr<Gtk::Tooltip>& tooltip);
   void populate_popup(Gtk::Menu* menu);
 
 private:
   MiddlewareInterface& middleware_;
   bool add_view_source_menu_item_;
-  int heading_level_;
-  int list_level_;
-  bool is_bold_;
-  bool is_italic_;
-  bool is_strikethrough_;
-  bool is_highlight_;
-  bool is_superscript_;
-  bool is_subscript_;
-  bool is_quote_;
-  int bullet_list_level_;
-  int ordered_list_level_;
-  bool is_ordered_list_;
-  bool is_link;
-  Glib::ustring link_url_;
-  std::map<int, int> ordered_list_counters;
   Glib::RefPtr<Gdk::Cursor> normal_cursor_;
   Glib::RefPtr<Gdk::Cursor> link_cursor_;
   Glib::RefPtr<Gdk::Cursor> text_cursor_;
   bool hoving_over_link_;
   bool is_user_action_;
-  std::vector<Glib::RefPtr<Gtk::TextMark>> headings_toc_;
+  std::vector<Heading> headings_;
+  std::vector<std::string> heading_titles_;
+  std::unordered_map<std::string, std::uint32_t> heading_title_ids_;
+  Glib::RefPtr<Gtk::TextMark> render_mark_;
+  Glib::RefPtr<Gtk::TextMark> scroll_mark_;
+  int pending_scroll_offset_; /* Character offset to scroll to once it is drawn, -1 if none */
+  std::vector<DocumentBlock> document_blocks_;
+  std::deque<std::shared_ptr<const RenderDocument>> render_queue_;
+  std::size_t render_op_index_;
+  std::size_t render_block_index_;
+  bool is_render_block_started_;
+  std::uint64_t render_block_fingerprint_;
+  int render_block_start_line_;
+  int render_block_char_offset_;
+  std::size_t render_block_heading_index_;
+  sigc::connection render_idle_handler_;
+  std::unordered_map<std::uint16_t, std::vector<Glib::RefPtr<Gtk::TextTag>>> tag_sets_;
+  Glib::RefPtr<Gtk::TextTag> link_tag_;
+  std::vector<LinkRange> links_;
+  std::vector<std::string> link_urls_;
+  std::unordered_map<std::string, std::uint32_t> link_url_ids_;
+  guint cursor_tick_id_;
+  int pointer_x_;
+  int pointer_y_;
 
-  std::vector<UndoRedoData> undo_pool_;
-  std::vector<UndoRedoData> redo_pool_;
+  UndoHistory undo_history_;
   sigc::connection begin_user_action_signal_handler;
   sigc::connection end_user_action_signal_handler;
   sigc::connection insert_text_signal_handler;
@@ -117,17 +159,28 @@ private:
   void enable_edit();
   void disable_edit();
   void follow_link(Gtk::TextBuffer::iterator& iter);
-  void process_node(cmark_node* node, cmark_event_type ev_type);
-  void encode_text(std::string& string) const;
-  void insert_text(std::string text, const Glib::ustring& url = "", CodeTypeEnum codeType = CodeTypeEnum::CODE_TYPE_NONE);
+  const std::string* get_link_url(const Gtk::TextBuffer::iterator& iter) const;
+  void clear_links();
+  void clear_headings();
+  void compact_heading_titles();
+  void compact_link_urls();
+  void queue_document(std::shared_ptr<const RenderDocument> document);
+  bool render_slice();
+  bool render_queued(std::chrono::steady_clock::time_point deadline);
+  void start_render_block(const RenderBlock& block);
+  void finish_render_block();
+  void cancel_rendering();
+  void scroll_when_drawn();
+  void render_block(const RenderDocument& document, const RenderBlock& render_block, DocumentBlock& block);
+  void render_op(const RenderDocument& document, const RenderOp& op);
+  const std::vector<Glib::RefPtr<Gtk::TextTag>>& get_tag_set(std::uint16_t format);
   void insert_tag_text(const Glib::ustring& text, std::vector<Glib::ustring> const& tag_names);
-  void add_heading_mark(const Glib::ustring& text, int heading_level);
+  void add_heading(const std::string& title, int heading_level, int source_line = 0);
   void insert_tag_text(const Glib::ustring& text, const Glib::ustring& tag_name);
   void insert_markup_text(const Glib::ustring& text);
-  void insert_link_text(const Glib::ustring& text, const Glib::ustring& url);
-  void truncate_text(int chars_truncated);
+  void insert_link_text(const Glib::ustring& text, const std::string& url);
+  Gtk::TextBuffer::iterator get_render_iter();
   void change_cursor(int x, int y);
-  static Glib::ustring int_to_roman(int num);
 };
 
 #endif
\ No newline at end of file
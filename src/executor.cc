@@ -0,0 +1,148 @@
+#include "executor.h"
+#include <iostream>
+#include <stdexcept>
+
+/**
+ * \brief Constructor, creates a new (not cancelled) cancellation flag
+ */
+CancellationToken::CancellationToken()
+    : is_cancelled_(std::make_shared<std::atomic<bool>>(false))
+{
+}
+
+/**
+ * \brief Cancel the task, the task stops as soon as it checks the token (or is skipped when it didn't start yet)
+ */
+void CancellationToken::cancel() const
+{
+  *is_cancelled_ = true;
+}
+
+/**
+ * \brief Check if the task is cancelled
+ * \return true if cancelled, otherwise false
+ */
+bool CancellationToken::is_cancelled() const
+{
+  return *is_cancelled_;
+}
+
+/**
+ * \brief Constructor, starts the worker thread of each lane
+ */
+Executor::Executor()
+    : is_stopping_(false)
+{
+  for (int lane = 0; lane < LANE_COUNT; ++lane)
+  {
+    workers_[lane].is_running = false;
+    workers_[lane].thread = std::thread(&Executor::run, this, static_cast<Lane>(lane));
+  }
+}
+
+/**
+ * \brief Destructor, see stop()
+ */
+Executor::~Executor()
+{
+  stop();
+}
+
+/**
+ * \brief Queue a task on a lane, the tasks of a lane run in order
+ * \param lane Lane of the task
+ * \param task Task to run, called with its cancellation token
+ * \return Cancellation token of the task
+ */
+CancellationToken Executor::post(Lane lane, Task task)
+{
+  CancellationToken token;
+  {
+    std::lock_guard<std::mutex> guard(mutex_);
+    if (is_stopping_)
+    {
+      token.cancel();
+      return token;
+    }
+    workers_[lane].queue.push_back({std::move(task), token});
+  }
+  task_condition_.notify_all();
+  return token;
+}
+
+/**
+ * \brief Cancel the running task as well as the queued tasks of a lane
+ * \param lane Lane of the tasks
+ */
+void Executor::cancel(Lane lane)
+{
+  std::lock_guard<std::mutex> guard(mutex_);
+  Worker& worker = workers_[lane];
+  if (worker.is_running)
+    worker.running_token.cancel();
+  for (const QueuedTask& queued : worker.queue)
+  {
+    queued.token.cancel();
+  }
+}
+
+/**
+ * \brief Cancel all the tasks and stop the worker threads, the running tasks are finished first.
+ * No tasks can be queued afterwards.
+ */
+void Executor::stop()
+{
+  {
+    std::lock_guard<std::mutex> guard(mutex_);
+    if (is_stopping_)
+      return;
+    is_stopping_ = true;
+  }
+  for (int lane = 0; lane < LANE_COUNT; ++lane)
+  {
+    cancel(static_cast<Lane>(lane));
+  }
+  task_condition_.notify_all();
+  for (Worker& worker : workers_)
+  {
+    if (worker.thread.joinable())
+      worker.thread.join();
+  }
+}
+
+/**
+ * Worker loop of a lane, runs the queued tasks until the executor is stopped
+ */
+void Executor::run(Lane lane)
+{
+  Worker& worker = workers_[lane];
+  std::unique_lock<std::mutex> lock(mutex_);
+  for (;;)
+  {
+    task_condition_.wait(lock, [this, &worker] { return is_stopping_ || !worker.queue.empty(); });
+    if (is_stopping_)
+      break;
+    QueuedTask queued = std::move(worker.queue.front());
+    worker.queue.pop_front();
+    if (!queued.token.is_cancelled())
+    {
+      worker.running_token = queued.token;
+      worker.is_running = true;
+      lock.unlock();
+      try
+      {
+        queued.task(queued.token);
+      }
+      catch (const std::exception& error)
+      {
+        std::cerr << "ERROR: Task failed. Message: " << error.what() << std::endl;
+      }
+      // Release the resources of the task outside the lock
+      queued = QueuedTask();
+      lock.lock();
+      worker.is_running = false;
+    }
+  }
+  // Queued tasks are dropped
+  worker.queue.clear();
+}
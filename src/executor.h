@@ -0,0 +1,91 @@
+#ifndef EXECUTOR_H
+#define EXECUTOR_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+/**
+ * \class CancellationToken
+ * \brief Shared cancellation flag of a task, copies of the token refer to the same flag
+ */
+class CancellationToken
+{
+public:
+  CancellationToken();
+  void cancel() const;
+  bool is_cancelled() const;
+
+private:
+  std::shared_ptr<std::atomic<bool>> is_cancelled_;
+};
+
+/**
+ * \class Executor
+ * \brief Long-lived worker threads, one for each lane, running the tasks of a lane in order.
+ * The lanes are separated, so a slow status call never delays a navigation request (and the other way around).
+ * The lanes are not prioritized, the worker threads are scheduled like any other thread.
+ * Every task gets a cancellation token, a cancelled task that is still queued is skipped.
+ */
+class Executor
+{
+public:
+  /**
+   * \enum Lane
+   * \brief Task lanes, each lane has its own worker thread
+   */
+  enum Lane
+  {
+    LANE_NAVIGATION = 0, /* Navigation requests (fetch & parse the requested page) */
+    LANE_PARSE,          /* Parsing outside of a navigation request (eg. the editor preview) */
+    LANE_BACKGROUND,     /* Background work that nobody waits for (eg. storing in the disk cache) */
+    LANE_STATUS,         /* IPFS status calls */
+    LANE_COUNT
+  };
+  typedef std::function<void(const CancellationToken& token)> Task;
+
+  Executor();
+  ~Executor();
+  Executor(const Executor&) = delete;
+  Executor& operator=(const Executor&) = delete;
+  CancellationToken post(Lane lane, Task task);
+  void cancel(Lane lane);
+  void stop();
+
+private:
+  /**
+   * \struct QueuedTask
+   * \brief Task with its cancellation token
+   */
+  struct QueuedTask
+  {
+    Task task;
+    CancellationToken token;
+  };
+
+  /**
+   * \struct Worker
+   * \brief Worker thread of a lane, with the queued tasks and the token of the running task
+   */
+  struct Worker
+  {
+    std::thread thread;
+    std::deque<QueuedTask> queue;
+    CancellationToken running_token;
+    bool is_running;
+  };
+
+  std::mutex mutex_;
+  std::condition_variable task_condition_; /* Wake-up the workers on a new task or stop */
+  bool is_stopping_;
+  Worker workers_[LANE_COUNT];
+
+  void run(Lane lane);
+};
+
+#endif
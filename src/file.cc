@@ -1,5 +1,6 @@
 #include "file.h"
 #include <fstream>
+#include <ios>
 #include <sstream>
 #include <stdexcept>
 
@@ -11,6 +12,110 @@ namespace n_fs = ::std::experimental::filesystem;
 namespace n_fs = ::std::filesystem;
 #endif
 
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/**
+ * \brief Map the file into memory (read-only)
+ * \param path File path
+ */
+MappedFile::MappedFile(const std::string& path)
+    : is_open_(false),
+      data_(nullptr),
+      size_(0)
+{
+#ifdef _WIN32
+  HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (file == INVALID_HANDLE_VALUE)
+    return;
+  LARGE_INTEGER file_size;
+  if (GetFileSizeEx(file, &file_size))
+  {
+    // An empty file can't be mapped, but is a valid (empty) file
+    is_open_ = (file_size.QuadPart == 0);
+    HANDLE mapping = (file_size.QuadPart > 0) ? CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr) : nullptr;
+    if (mapping != nullptr)
+    {
+      data_ = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+      if (data_ != nullptr)
+      {
+        size_ = static_cast<std::size_t>(file_size.QuadPart);
+        is_open_ = true;
+      }
+      CloseHandle(mapping);
+    }
+  }
+  CloseHandle(file);
+#else
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd == -1)
+    return;
+  struct stat file_stat;
+  if (fstat(fd, &file_stat) == 0)
+  {
+    // An empty file can't be mapped, but is a valid (empty) file
+    is_open_ = (file_stat.st_size == 0);
+    void* data = (file_stat.st_size > 0) ? mmap(nullptr, static_cast<std::size_t>(file_stat.st_size), PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+    if (data != MAP_FAILED)
+    {
+      // The file is mostly read from start to end
+      madvise(data, static_cast<std::size_t>(file_stat.st_size), MADV_SEQUENTIAL);
+      data_ = static_cast<const char*>(data);
+      size_ = static_cast<std::size_t>(file_stat.st_size);
+      is_open_ = true;
+    }
+  }
+  close(fd);
+#endif
+}
+
+/**
+ * \brief Destructor, unmap the file
+ */
+MappedFile::~MappedFile()
+{
+  if (data_ == nullptr)
+    return;
+#ifdef _WIN32
+  UnmapViewOfFile(data_);
+#else
+  munmap(const_cast<char*>(data_), size_);
+#endif
+}
+
+/**
+ * \brief Check if the file is opened and mapped
+ * \return true if the file could be mapped (or is empty), otherwise false
+ */
+bool MappedFile::is_open() const
+{
+  return is_open_;
+}
+
+/**
+ * \brief Get the mapped content
+ * \return Pointer to the content, nullptr if the file is empty or not mapped
+ */
+const char* MappedFile::data() const
+{
+  return data_;
+}
+
+/**
+ * \brief Get the size of the mapped content
+ * \return Size in bytes
+ */
+std::size_t MappedFile::size() const
+{
+  return size_;
+}
+
 /**
  * \brief Read file from disk
  * \param path File path location to read the file from
@@ -36,6 +141,27 @@ std::string File::read(const std::string& path)
   }
 }
 
+/**
+ * \brief Map file from disk into memory, without copying the content.
+ * Especially for large files, the content is only read from disk when it is accessed.
+ * \param path File path location to read the file from
+ * \throw std::runtime_error exception when file is not found (or not a regular file),
+ *        or std::ios_base::failure when file can't be mapped
+ * \return Mapped file
+ */
+std::unique_ptr<MappedFile> File::map(const std::string& path)
+{
+  if (!n_fs::exists(path) || !n_fs::is_regular_file(path))
+  {
+    // File doesn't exists or isn't a file
+    throw std::runtime_error("File does not exists or isn't a regular file.");
+  }
+  auto file = std::make_unique<MappedFile>(path);
+  if (!file->is_open())
+    throw std::ios_base::failure("File can't be opened.");
+  return file;
+}
+
 /**
  * \brief Write file to disk
  * \param path File path location for storing the file
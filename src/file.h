@@ -1,8 +1,31 @@
 #ifndef FILE_H
 #define FILE_H
 
+#include <cstddef>
+#include <memory>
 #include <string>
 
+/**
+ * \class MappedFile
+ * \brief Read-only memory-mapped file, the pages are only read from disk when they are accessed
+ */
+class MappedFile
+{
+public:
+  explicit MappedFile(const std::string& path);
+  ~MappedFile();
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+  bool is_open() const;
+  const char* data() const;
+  std::size_t size() const;
+
+private:
+  bool is_open_;
+  const char* data_;
+  std::size_t size_;
+};
+
 /**
  * \class File
  * \brief Read/write markdown files from disk and retrieve filename from path
@@ -11,6 +34,7 @@ class File
 {
 public:
   static std::string read(const std::string& path);
+  static std::unique_ptr<MappedFile> map(const std::string& path);
   static void write(const std::string& path, const std::string& content);
   static std::string get_filename(const std::string& path);
 };
@@ -0,0 +1,276 @@
+#include "incremental-parser.h"
+#include "md-parser.h"
+
+#include <algorithm>
+#include <cstring>
+#include <node.h>
+
+static const int MaxRegionExtensions = 8;
+
+IncrementalParser::IncrementalParser()
+    : document_(nullptr),
+      has_references_(false)
+{
+}
+
+IncrementalParser::~IncrementalParser()
+{
+  reset();
+}
+
+/**
+ * \brief Update the document with the new content. Only the top-level blocks touched by the edit (and their direct neighbours)
+ * are parsed again, when the edit can not be isolated the whole document is parsed.
+ * Note: The returned AST remains owned by the incremental parser, it stays valid until the next update() or reset() call.
+ * \param content New content of the document
+ * \return AST structure (of type cmark_node)
+ */
+cmark_node* IncrementalParser::update(Glib::ustring content)
+{
+  const std::string& old_text = content_.raw();
+  const std::string& new_text = content.raw();
+  bool has_references = Parser::has_reference_definition(new_text.data(), new_text.size());
+  if (document_ == nullptr || blocks_.empty() || has_references || has_references_)
+  {
+    content_ = std::move(content);
+    has_references_ = has_references;
+    parse_full();
+    return document_;
+  }
+  if (old_text == new_text)
+    return document_;
+
+  // Find the changed range, by stripping the common prefix and suffix
+  std::size_t old_size = old_text.size();
+  std::size_t new_size = new_text.size();
+  std::size_t max_common = std::min(old_size, new_size);
+  std::size_t prefix = 0;
+  while (prefix < max_common && old_text[prefix] == new_text[prefix])
+    ++prefix;
+  std::size_t suffix = 0;
+  while (suffix < max_common - prefix && old_text[old_size - suffix - 1] == new_text[new_size - suffix - 1])
+    ++suffix;
+  long delta = static_cast<long>(new_size) - static_cast<long>(old_size);
+
+  // Touched blocks, extended with their direct neighbours
+  auto block_at = [this](std::size_t offset)
+  {
+    auto it = std::upper_bound(blocks_.begin(), blocks_.end(), offset, [](std::size_t value, const Block& block) { return value < block.begin; });
+    return (it == blocks_.begin()) ? 0 : static_cast<std::size_t>(std::distance(blocks_.begin(), it) - 1);
+  };
+  std::size_t first = block_at(prefix);
+  std::size_t last = block_at(old_size - suffix);
+  if (first > 0)
+    --first;
+  if (last + 1 < blocks_.size())
+    ++last;
+
+  content_ = std::move(content);
+  for (int i = 0; i < MaxRegionExtensions; ++i)
+  {
+    std::size_t begin = (first == 0) ? 0 : blocks_[first].begin;
+    std::size_t old_end = (last + 1 < blocks_.size()) ? blocks_[last + 1].begin : old_size;
+    std::size_t new_end = old_end + delta;
+    // The block before the region needs to be closed, a list could continue into the region
+    if (first > 0 && (!is_safe_boundary(content_.raw(), begin) || cmark_node_get_type(blocks_[first - 1].node) == CMARK_NODE_LIST))
+    {
+      --first;
+      continue;
+    }
+    if (last + 1 < blocks_.size() && !is_safe_boundary(content_.raw(), new_end))
+    {
+      ++last;
+      continue;
+    }
+    if (parse_region(first, last, begin, new_end, delta))
+      return document_;
+    if (last + 1 < blocks_.size())
+      ++last;
+    else if (first > 0)
+      --first;
+    else
+      break;
+  }
+  parse_full();
+  return document_;
+}
+
+/**
+ * \brief Get the current document
+ * \return AST structure (of type cmark_node), nullptr when nothing is parsed yet
+ */
+cmark_node* IncrementalParser::get_document() const
+{
+  return document_;
+}
+
+/**
+ * \brief Free the current document and forget the content
+ */
+void IncrementalParser::reset()
+{
+  if (document_ != nullptr)
+  {
+    cmark_node_free(document_);
+    document_ = nullptr;
+  }
+  blocks_.clear();
+  content_.clear();
+  has_references_ = false;
+}
+
+/**
+ * \brief Parse the whole content and rebuild the block table
+ */
+void IncrementalParser::parse_full()
+{
+  if (document_ != nullptr)
+    cmark_node_free(document_);
+  blocks_.clear();
+
+  const std::string& text = content_.raw();
+  document_ = Parser::parse_content(text.data(), text.size());
+  std::vector<std::size_t> line_offsets = get_line_offsets(text.data(), text.size());
+  for (cmark_node* node = cmark_node_first_child(document_); node != nullptr; node = cmark_node_next(node))
+  {
+    int line = blocks_.empty() ? 1 : node->start_line;
+    std::size_t begin = blocks_.empty() ? 0 : line_offsets[line - 1];
+    blocks_.push_back({begin, line, node});
+  }
+}
+
+/**
+ * \brief Parse the region of blocks first until last (inclusive) again, and splice the result into the document.
+ * \param first Index of the first block in the region
+ * \param last Index of the last block in the region
+ * \param begin Byte offset of the region in the new content
+ * \param end Byte offset of the region end in the new content
+ * \param delta Difference in size between the new and old content
+ * \return True when the region is spliced, false when the region doesn't parse in isolation (and nothing is changed)
+ */
+bool IncrementalParser::parse_region(std::size_t first, std::size_t last, std::size_t begin, std::size_t end, long delta)
+{
+  const char* data = content_.raw().data() + begin;
+  std::size_t length = end - begin;
+  bool has_next = (last + 1 < blocks_.size());
+  cmark_node* region = Parser::parse_content(data, length);
+  std::vector<std::size_t> line_offsets = get_line_offsets(data, length);
+  int region_lines = static_cast<int>(line_offsets.size()) - 1;
+
+  // An unclosed block (eg. code fence or list) would continue into the next block, when parsing the whole document
+  cmark_node* region_last = cmark_node_last_child(region);
+  if (has_next && region_last != nullptr && region_last->end_line >= region_lines)
+  {
+    cmark_node_free(region);
+    return false;
+  }
+
+  int start_line = (first == 0) ? 1 : blocks_[first].line;
+  int line_delta = has_next ? region_lines - (blocks_[last + 1].line - start_line) : 0;
+  cmark_node* next = has_next ? blocks_[last + 1].node : nullptr;
+
+  std::vector<Block> new_blocks;
+  cmark_node* node = cmark_node_first_child(region);
+  while (node != nullptr)
+  {
+    cmark_node* following = cmark_node_next(node);
+    int line = new_blocks.empty() ? 1 : node->start_line;
+    new_blocks.push_back({begin + line_offsets[line - 1], start_line + line - 1, node});
+    shift_lines(node, start_line - 1);
+    if (next != nullptr)
+      cmark_node_insert_before(next, node);
+    else
+      cmark_node_append_child(document_, node);
+    node = following;
+  }
+  if (has_next)
+  {
+    document_->end_line += line_delta;
+  }
+  else
+  {
+    document_->end_line = region->end_line + start_line - 1;
+    document_->end_column = region->end_column;
+  }
+  cmark_node_free(region);
+
+  for (std::size_t i = first; i <= last; ++i)
+    cmark_node_free(blocks_[i].node);
+  for (std::size_t i = last + 1; i < blocks_.size(); ++i)
+  {
+    blocks_[i].begin += delta;
+    blocks_[i].line += line_delta;
+    shift_lines(blocks_[i].node, line_delta);
+  }
+  blocks_.erase(blocks_.begin() + first, blocks_.begin() + last + 1);
+  blocks_.insert(blocks_.begin() + first, new_blocks.begin(), new_blocks.end());
+  if (!blocks_.empty())
+  {
+    blocks_.front().begin = 0;
+    blocks_.front().line = 1;
+  }
+  return true;
+}
+
+/**
+ * \brief Check if a new top-level block starting at offset is parsed the same way with or without the preceding text.
+ * This is the case when the line before is blank and the line itself is not indented (no continuation of any block).
+ * \param text Content
+ * \param offset Byte offset of the line start
+ * \return True when the content can be split at the offset
+ */
+bool IncrementalParser::is_safe_boundary(const std::string& text, std::size_t offset)
+{
+  if (offset == 0 || offset >= text.size() || text[offset - 1] != '\n')
+    return false;
+  if (text[offset] == ' ' || text[offset] == '\t')
+    return false;
+  std::size_t pos = offset - 1;
+  while (pos > 0 && text[pos - 1] != '\n')
+  {
+    char c = text[pos - 1];
+    if (c != ' ' && c != '\t' && c != '\r')
+      return false;
+    --pos;
+  }
+  return true;
+}
+
+/**
+ * \brief Get the byte offsets of each line start, the last entry is the length (start of the line after the content)
+ */
+std::vector<std::size_t> IncrementalParser::get_line_offsets(const char* data, std::size_t length)
+{
+  std::vector<std::size_t> offsets{0};
+  const char* end = data + length;
+  for (const char* pos = data; (pos = static_cast<const char*>(std::memchr(pos, '\n', end - pos))) != nullptr; ++pos)
+    offsets.push_back(static_cast<std::size_t>(pos - data) + 1);
+  if (offsets.back() != length)
+    offsets.push_back(length);
+  return offsets;
+}
+
+/**
+ * \brief Shift the source positions of the node and all its children
+ */
+void IncrementalParser::shift_lines(cmark_node* node, int line_delta)
+{
+  if (line_delta == 0)
+    return;
+  cmark_iter* iter = cmark_iter_new(node);
+  cmark_event_type ev_type;
+  while ((ev_type = cmark_iter_next(iter)) != CMARK_EVENT_DONE)
+  {
+    if (ev_type == CMARK_EVENT_ENTER)
+    {
+      // Line 0 means no source position (eg. soft breaks)
+      cmark_node* cur = cmark_iter_get_node(iter);
+      if (cur->start_line > 0)
+      {
+        cur->start_line += line_delta;
+        cur->end_line += line_delta;
+      }
+    }
+  }
+  cmark_iter_free(iter);
+}
@@ -0,0 +1,52 @@
+#ifndef INCREMENTAL_PARSER_H
+#define INCREMENTAL_PARSER_H
+
+#include <cstddef>
+#include <glibmm/ustring.h>
+#include <vector>
+
+/* Forward declarations */
+struct cmark_node;
+
+/**
+ * \class IncrementalParser
+ * \brief Keeps the AST of a document that is edited, re-parsing only the top-level blocks touched by an edit.
+ * The re-parsed blocks are spliced into the existing AST, untouched blocks are kept as-is.
+ */
+class IncrementalParser
+{
+public:
+  IncrementalParser();
+  ~IncrementalParser();
+  IncrementalParser(const IncrementalParser&) = delete;
+  IncrementalParser& operator=(const IncrementalParser&) = delete;
+
+  cmark_node* update(Glib::ustring content);
+  cmark_node* get_document() const;
+  void reset();
+
+private:
+  /**
+   * \struct Block
+   * \brief Top-level block in the document. A block spans from its begin offset until the begin of the next block.
+   */
+  struct Block
+  {
+    std::size_t begin; /* Byte offset of the first line of the block */
+    int line;          /* Line number of the first line of the block (1-based) */
+    cmark_node* node;  /* Top-level node in the document */
+  };
+
+  Glib::ustring content_;     /* Content of the current document */
+  cmark_node* document_;      /* Current AST, owned by the incremental parser */
+  std::vector<Block> blocks_; /* Top-level blocks, sorted by source position */
+  bool has_references_;       /* Link reference definitions can affect the whole document, always fully re-parse */
+
+  void parse_full();
+  bool parse_region(std::size_t first, std::size_t last, std::size_t begin, std::size_t end, long delta);
+  static bool is_safe_boundary(const std::string& text, std::size_t offset);
+  static std::vector<std::size_t> get_line_offsets(const char* data, std::size_t length);
+  static void shift_lines(cmark_node* node, int line_delta);
+};
+
+#endif
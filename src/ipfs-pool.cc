@@ -0,0 +1,60 @@
+#include "ipfs-pool.h"
+
+/**
+ * \brief Constructor, connections are created when they are needed
+ * \param address IPFS API address (TCP or unix socket)
+ * \param timeout IPFS time-out (which is a string, eg. "6s" for 6 seconds)
+ * \param max_idle Maximum number of idle connections that are kept
+ */
+IPFSPool::IPFSPool(const ApiAddress& address, const std::string& timeout, std::size_t max_idle)
+    : address_(address),
+      timeout_(timeout),
+      max_idle_(max_idle)
+{
+}
+
+/**
+ * \brief Lease a connection, the most recently used idle connection is reused (its keep-alive connection is the most likely to be open).
+ * The connection is returned to the pool when the last reference is released, the pool should outlive the leased connections.
+ * \return Connection, used by a single thread at a time. Except for abort(), which can be called from any thread
+ */
+IPFSPool::Connection IPFSPool::acquire()
+{
+  std::unique_ptr<IPFS> ipfs;
+  {
+    std::lock_guard<std::mutex> guard(mutex_);
+    if (!idle_.empty())
+    {
+      ipfs = std::move(idle_.back());
+      idle_.pop_back();
+    }
+  }
+  // Allow new API requests/calls again on a reused connection, in case its previous request was aborted
+  if (ipfs)
+    ipfs->reset();
+  else
+    ipfs = std::make_unique<IPFS>(address_, timeout_);
+  return Connection(ipfs.release(), [this](IPFS* released) { release(released); });
+}
+
+/**
+ * \brief Get the number of idle connections
+ * \return Number of connections in the pool that are not leased
+ */
+std::size_t IPFSPool::get_idle_count() const
+{
+  std::lock_guard<std::mutex> guard(mutex_);
+  return idle_.size();
+}
+
+/**
+ * Return a leased connection to the pool, or close it when enough connections are idle already
+ */
+void IPFSPool::release(IPFS* ipfs)
+{
+  // Declared before the lock, so a closed connection is destroyed outside the lock
+  std::unique_ptr<IPFS> connection(ipfs);
+  std::lock_guard<std::mutex> guard(mutex_);
+  if (idle_.size() < max_idle_)
+    idle_.push_back(std::move(connection));
+}
@@ -0,0 +1,41 @@
+#ifndef IPFS_POOL_H
+#define IPFS_POOL_H
+
+#include "ipfs.h"
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * \class IPFSPool
+ * \brief Pool of IPFS connections to the same daemon. Each connection keeps its HTTP handles between requests,
+ * so the (keep-alive) connection to the daemon is reused instead of set up again for every request.
+ * A connection is leased by a single worker at a time, requests on different workers run concurrently.
+ * Leased connections are returned to the pool when the last reference is released, a limited number is kept idle.
+ */
+class IPFSPool
+{
+public:
+  typedef std::shared_ptr<IPFS> Connection;
+
+  explicit IPFSPool(const ApiAddress& address, const std::string& timeout, std::size_t max_idle = DefaultMaxIdle);
+  IPFSPool(const IPFSPool&) = delete;
+  IPFSPool& operator=(const IPFSPool&) = delete;
+  Connection acquire();
+  std::size_t get_idle_count() const;
+
+  static const std::size_t DefaultMaxIdle = 4;
+
+private:
+  mutable std::mutex mutex_;
+  ApiAddress address_;                      /* IPFS API address */
+  std::string timeout_;                     /* IPFS time-out (eg. 6s) */
+  std::size_t max_idle_;                    /* Maximum number of idle connections that are kept */
+  std::vector<std::unique_ptr<IPFS>> idle_; /* Idle connections, the most recently used connection is at the back */
+
+  void release(IPFS* ipfs);
+};
+
+#endif
@@ -1,16 +1,61 @@
 #include "ipfs.h"
+#include "json-scanner.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <streambuf>
+
+// The start of the response is kept, so the error body can still be read back when the request fails
+static const std::size_t ChunkStreamRetainSize = 4096;
+
+/**
+ * \class ChunkStreamBuffer
+ * \brief Stream buffer that passes each written chunk directly to a callback, instead of storing the whole response
+ */
+class ChunkStreamBuffer : public std::streambuf
+{
+public:
+  explicit ChunkStreamBuffer(const std::function<void(const char*, std::size_t)>& chunk_callback)
+      : chunk_callback_(chunk_callback)
+  {
+  }
+
+protected:
+  std::streamsize xsputn(const char* data, std::streamsize length) override
+  {
+    if (retained_.size() < ChunkStreamRetainSize)
+    {
+      retained_.append(data, std::min(static_cast<std::size_t>(length), ChunkStreamRetainSize - retained_.size()));
+      setg(retained_.data(), retained_.data() + (gptr() - eback()), retained_.data() + retained_.size());
+    }
+    chunk_callback_(data, static_cast<std::size_t>(length));
+    return length;
+  }
+
+  int_type overflow(int_type ch) override
+  {
+    if (traits_type::eq_int_type(ch, traits_type::eof()))
+      return traits_type::not_eof(ch);
+    char c = traits_type::to_char_type(ch);
+    xsputn(&c, 1);
+    return ch;
+  }
+
+private:
+  const std::function<void(const char*, std::size_t)>& chunk_callback_;
+  std::string retained_;
+};
 
 /**
  * \brief IPFS Contructor, connect to IPFS
- * \param host IPFS host (eg. localhost)
- * \param port IPFS port number (5001)
+ * \param address IPFS API address, TCP (eg. 127.0.0.1 port 5001) or a unix socket
  * \param timeout IPFS time-out (which is a string, eg. "6s" for 6 seconds)
  */
-IPFS::IPFS(const std::string& host, int port, const std::string& timeout)
-    : host_(host),
-      port_(port),
+IPFS::IPFS(const ApiAddress& address, const std::string& timeout)
+    : address_(address),
       timeout_(timeout),
-      client_(this->host_, this->port_, this->timeout_)
+      client_(address_.host, address_.port, timeout_),
+      transport_(address_)
 {
 }
 
@@ -20,31 +65,24 @@ IPFS::IPFS(const std::string& host, int port, const std::string& timeout)
  */
 std::size_t IPFS::get_nr_peers()
 {
-  ipfs::Json peers;
-  client_.SwarmPeers(&peers);
-  return peers["Peers"].size();
+  // Only the peers are counted, the peer list itself (with addresses, latencies, etc.) is never stored
+  JsonScanner peers;
+  fetch_json("swarm/peers", peers);
+  return peers.get_array_size("Peers");
 }
 
 /**
- * \brief Retrieve your IPFS client ID.
- * \return ID as string
+ * \brief Retrieve your IPFS client ID and public key, with a single call.
+ * \return Map with client info (with keys: 'id' and 'public-key')
  */
-std::string IPFS::get_client_id()
+std::map<std::string, std::string> IPFS::get_client_info()
 {
-  ipfs::Json id;
-  client_.Id(&id);
-  return id["ID"];
-}
-
-/**
- * \brief Retrieve your IPFS Public Key.
- * \return Public key string
- */
-std::string IPFS::get_client_public_key()
-{
-  ipfs::Json id;
-  client_.Id(&id);
-  return id["PublicKey"];
+  std::map<std::string, std::string> client_info;
+  JsonScanner id;
+  fetch_json("id", id);
+  client_info.insert(std::pair<std::string, std::string>("id", id.get_value("ID")));
+  client_info.insert(std::pair<std::string, std::string>("public-key", id.get_value("PublicKey")));
+  return client_info;
 }
 
 /**
@@ -53,9 +91,9 @@ std::string IPFS::get_client_public_key()
  */
 std::string IPFS::get_version()
 {
-  ipfs::Json version;
-  client_.Version(&version);
-  return version["Version"];
+  JsonScanner version;
+  fetch_json("version", version);
+  return version.get_value("Version");
 }
 
 /**
@@ -65,10 +103,10 @@ std::string IPFS::get_version()
 std::map<std::string, float> IPFS::get_bandwidth_rates()
 {
   std::map<std::string, float> bandwidth_rates;
-  ipfs::Json bandwidth_info;
-  client_.StatsBw(&bandwidth_info);
-  float in = bandwidth_info["RateIn"];
-  float out = bandwidth_info["RateOut"];
+  JsonScanner bandwidth_info;
+  fetch_json("stats/bw", bandwidth_info);
+  float in = std::strtof(bandwidth_info.get_value("RateIn").c_str(), nullptr);
+  float out = std::strtof(bandwidth_info.get_value("RateOut").c_str(), nullptr);
   bandwidth_rates.insert(std::pair<std::string, float>("in", in));
   bandwidth_rates.insert(std::pair<std::string, float>("out", out));
   return bandwidth_rates;
@@ -81,10 +119,11 @@ std::map<std::string, float> IPFS::get_bandwidth_rates()
 std::map<std::string, std::variant<int, std::string>> IPFS::get_repo_stats()
 {
   std::map<std::string, std::variant<int, std::string>> repo_stats;
-  ipfs::Json repo_stats_info;
-  client_.StatsRepo(&repo_stats_info);
-  int repo_size = (int)repo_stats_info["RepoSize"] / 1000000; // Convert from bytes to MB
-  std::string repo_path = repo_stats_info["RepoPath"];
+  JsonScanner repo_stats_info;
+  fetch_json("stats/repo", repo_stats_info);
+  // Convert from bytes to MB
+  int repo_size = static_cast<int>(std::strtoull(repo_stats_info.get_value("RepoSize").c_str(), nullptr, 10) / 1000000);
+  std::string repo_path = repo_stats_info.get_value("RepoPath");
   repo_stats.insert(std::pair<std::string, int>("repo-size", repo_size));
   repo_stats.insert(std::pair<std::string, std::string>("path", repo_path));
   return repo_stats;
@@ -99,7 +138,31 @@ std::map<std::string, std::variant<int, std::string>> IPFS::get_repo_stats()
  */
 void IPFS::fetch(const std::string& path, std::iostream* contents)
 {
-  client_.FilesGet(path, contents);
+  if (address_.is_unix_socket())
+    transport_.post(get_url("cat", "arg=" + transport_.escape(path)),
+                    [contents](const char* data, std::size_t length) { contents->write(data, static_cast<std::streamsize>(length)); });
+  else
+    client_.FilesGet(path, contents);
+}
+
+/**
+ * \brief Fetch file from IFPS network, while streaming the file contents in chunks as they are received
+ * \param path File path
+ * \param chunk_callback Called for each received chunk of the file contents (from the fetch thread)
+ * \throw std::runtime_error when there is a
+ * connection-time/something goes wrong while trying to get the file
+ */
+void IPFS::fetch(const std::string& path, const std::function<void(const char* data, std::size_t length)>& chunk_callback)
+{
+  // The IPFS client doesn't support unix sockets
+  if (address_.is_unix_socket())
+  {
+    transport_.post(get_url("cat", "arg=" + transport_.escape(path)), chunk_callback);
+    return;
+  }
+  ChunkStreamBuffer buffer(chunk_callback);
+  std::iostream contents(&buffer);
+  client_.FilesGet(path, &contents);
 }
 
 /**
@@ -113,6 +176,16 @@ std::string IPFS::add(const std::string& path, const std::string& content)
 {
   ipfs::Json result;
   std::string hash;
+  if (address_.is_unix_socket())
+  {
+    JsonScanner added;
+    transport_.post_file(get_url("add", "stream-channels=true&encoding=json"), path, content,
+                         [&added](const char* data, std::size_t length) { added.feed(data, length); });
+    hash = added.get_value("Hash");
+    if (hash.empty())
+      throw std::runtime_error("File is not added, result is incorrect.");
+    return hash;
+  }
   // Publish a single file
   client_.FilesAdd({{path, ipfs::http::FileUpload::Type::kFileContents, content}}, &result);
   if (result.is_array() && result.size() > 0)
@@ -136,6 +209,7 @@ std::string IPFS::add(const std::string& path, const std::string& content)
 void IPFS::abort()
 {
   client_.Abort();
+  transport_.stop();
 }
 
 /**
@@ -144,4 +218,28 @@ void IPFS::abort()
 void IPFS::reset()
 {
   client_.Reset();
+  transport_.reset();
+}
+
+/**
+ * \brief Call the IPFS HTTP API, while scanning the JSON response as it is received (without building a JSON document)
+ * \param command API command (eg. swarm/peers)
+ * \param scanner JSON scanner that is fed with the response
+ * \throw std::runtime_error when there is a connection-time/something goes wrong with the call
+ */
+void IPFS::fetch_json(const std::string& command, JsonScanner& scanner)
+{
+  transport_.post(get_url(command, "stream-channels=true&encoding=json"),
+                  [&scanner](const char* data, std::size_t length) { scanner.feed(data, length); });
+}
+
+/**
+ * URL of an API call, the time-out is added to the arguments
+ */
+std::string IPFS::get_url(const std::string& command, const std::string& arguments) const
+{
+  std::string url = address_.get_base_url() + "/api/v0/" + command + "?" + arguments;
+  if (!timeout_.empty())
+    url += "&timeout=" + timeout_;
+  return url;
 }
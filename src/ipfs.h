@@ -1,12 +1,17 @@
 #ifndef IPFS_H
 #define IPFS_H
 
+#include "api-transport.h"
 #include "ipfs/client.h"
+#include <functional>
 #include <iostream>
 #include <map>
 #include <string>
 #include <variant>
 
+/* Forward declarations */
+class JsonScanner;
+
 /**
  * \class IPFS
  * \brief IPFS Abstraction Layer to the C++ IPFS HTTP Client
@@ -14,22 +19,25 @@
 class IPFS
 {
 public:
-  explicit IPFS(const std::string& host, int port, const std::string& timeout);
+  explicit IPFS(const ApiAddress& address, const std::string& timeout);
   std::size_t get_nr_peers();
-  std::string get_client_id();
-  std::string get_client_public_key();
+  std::map<std::string, std::string> get_client_info();
   std::string get_version();
   std::map<std::string, float> get_bandwidth_rates();
   std::map<std::string, std::variant<int, std::string>> get_repo_stats();
   void fetch(const std::string& path, std::iostream* contents);
+  void fetch(const std::string& path, const std::function<void(const char* data, std::size_t length)>& chunk_callback);
   std::string add(const std::string& path, const std::string& content);
   void abort();
   void reset();
 
 private:
-  std::string host_;    /* IPFS host name */
-  int port_;            /* IFPS port number */
-  std::string timeout_; /* IPFS timeout (eg. 6s) */
-  ipfs::Client client_; /* IPFS Client object */
+  ApiAddress address_;     /* IPFS API address (TCP or unix socket) */
+  std::string timeout_;    /* IPFS timeout (eg. 6s) */
+  ipfs::Client client_;    /* IPFS Client object, only used for TCP */
+  ApiTransport transport_; /* HTTP transport for the status calls (the responses are scanned while received), and all calls over a unix socket */
+
+  std::string get_url(const std::string& command, const std::string& arguments) const;
+  void fetch_json(const std::string& command, JsonScanner& scanner);
 };
 #endif
\ No newline at end of file
@@ -0,0 +1,228 @@
+#include "json-scanner.h"
+
+JsonScanner::JsonScanner()
+    : capture_(CAPTURE_NONE),
+      depth_(0),
+      is_expecting_key_(false),
+      in_string_(false),
+      in_literal_(false),
+      is_escape_(false),
+      unicode_digits_(0),
+      unicode_value_(0),
+      is_counting_(false),
+      is_element_expected_(false)
+{
+}
+
+/**
+ * \brief Feed the next chunk of the JSON response
+ * \param data Pointer to the chunk
+ * \param length Length of the chunk in bytes
+ */
+void JsonScanner::feed(const char* data, std::size_t length)
+{
+  for (std::size_t i = 0; i < length; ++i)
+  {
+    char c = data[i];
+    if (in_string_)
+    {
+      scan_string(c);
+      continue;
+    }
+    if (in_literal_)
+    {
+      if (c != ',' && c != '}' && c != ']' && c != ' ' && c != '\t' && c != '\n' && c != '\r')
+      {
+        if (capture_ == CAPTURE_VALUE)
+          buffer_ += c;
+        continue;
+      }
+      end_literal();
+    }
+    switch (c)
+    {
+    case '"':
+      begin_value();
+      in_string_ = true;
+      buffer_.clear();
+      capture_ = (depth_ == 1) ? (is_expecting_key_ ? CAPTURE_KEY : CAPTURE_VALUE) : CAPTURE_NONE;
+      break;
+    case '{':
+    case '[':
+      begin_value();
+      if (depth_ == 1 && c == '[')
+      {
+        // Count the elements of an array in the top-level object
+        array_sizes_[key_] = 0;
+        is_counting_ = true;
+        is_element_expected_ = true;
+      }
+      depth_++;
+      if (depth_ == 1)
+        is_expecting_key_ = true;
+      break;
+    case '}':
+    case ']':
+      depth_--;
+      if (depth_ == 1)
+        is_counting_ = false;
+      break;
+    case ',':
+      if (depth_ == 1)
+        is_expecting_key_ = true;
+      else if (depth_ == 2 && is_counting_)
+        is_element_expected_ = true;
+      break;
+    case ':':
+      if (depth_ == 1)
+        is_expecting_key_ = false;
+      break;
+    case ' ':
+    case '\t':
+    case '\n':
+    case '\r':
+      break;
+    default:
+      begin_value();
+      in_literal_ = true;
+      buffer_.assign(1, c);
+      capture_ = (depth_ == 1 && !is_expecting_key_) ? CAPTURE_VALUE : CAPTURE_NONE;
+      break;
+    }
+  }
+}
+
+/**
+ * \brief Get a scalar value of the top-level object
+ * \param key Key in the top-level object
+ * \return Value (unescaped string, or the literal as-is, eg. "42"), empty when not found
+ */
+std::string JsonScanner::get_value(const std::string& key) const
+{
+  auto it = values_.find(key);
+  return (it != values_.end()) ? it->second : std::string();
+}
+
+/**
+ * \brief Get the number of elements of an array in the top-level object
+ * \param key Key in the top-level object
+ * \return Number of elements, zero when not found (or not an array, eg. null)
+ */
+std::size_t JsonScanner::get_array_size(const std::string& key) const
+{
+  auto it = array_sizes_.find(key);
+  return (it != array_sizes_.end()) ? it->second : 0;
+}
+
+/**
+ * Scan a character within a string, including the escape sequences
+ */
+void JsonScanner::scan_string(char c)
+{
+  if (unicode_digits_ > 0)
+  {
+    unsigned int digit = 0;
+    if (c >= '0' && c <= '9')
+      digit = c - '0';
+    else if (c >= 'a' && c <= 'f')
+      digit = c - 'a' + 10;
+    else if (c >= 'A' && c <= 'F')
+      digit = c - 'A' + 10;
+    unicode_value_ = (unicode_value_ << 4) | digit;
+    if (--unicode_digits_ == 0)
+      append_code_point(unicode_value_);
+    return;
+  }
+  if (is_escape_)
+  {
+    is_escape_ = false;
+    char unescaped = c;
+    switch (c)
+    {
+    case 'b':
+      unescaped = '\b';
+      break;
+    case 'f':
+      unescaped = '\f';
+      break;
+    case 'n':
+      unescaped = '\n';
+      break;
+    case 'r':
+      unescaped = '\r';
+      break;
+    case 't':
+      unescaped = '\t';
+      break;
+    case 'u':
+      unicode_digits_ = 4;
+      unicode_value_ = 0;
+      return;
+    }
+    if (capture_ != CAPTURE_NONE)
+      buffer_ += unescaped;
+    return;
+  }
+  if (c == '\\')
+  {
+    is_escape_ = true;
+  }
+  else if (c == '"')
+  {
+    in_string_ = false;
+    if (capture_ == CAPTURE_KEY)
+      key_ = buffer_;
+    else if (capture_ == CAPTURE_VALUE)
+      values_[key_] = buffer_;
+  }
+  else if (capture_ != CAPTURE_NONE)
+  {
+    buffer_ += c;
+  }
+}
+
+/**
+ * End of a literal (number, true, false or null)
+ */
+void JsonScanner::end_literal()
+{
+  in_literal_ = false;
+  if (capture_ == CAPTURE_VALUE)
+    values_[key_] = buffer_;
+}
+
+/**
+ * A value starts, count it when it's a new element of an array in the top-level object
+ */
+void JsonScanner::begin_value()
+{
+  if (depth_ == 2 && is_counting_ && is_element_expected_)
+  {
+    array_sizes_[key_]++;
+    is_element_expected_ = false;
+  }
+}
+
+/**
+ * Append the code point of a \uXXXX escape as UTF-8 (surrogate pairs are not combined)
+ */
+void JsonScanner::append_code_point(unsigned int code_point)
+{
+  if (capture_ == CAPTURE_NONE)
+    return;
+  if (code_point < 0x80)
+  {
+    buffer_ += static_cast<char>(code_point);
+  }
+  else if (code_point < 0x800)
+  {
+    buffer_ += static_cast<char>(0xC0 | (code_point >> 6));
+    buffer_ += static_cast<char>(0x80 | (code_point & 0x3F));
+  }
+  else
+  {
+    buffer_ += static_cast<char>(0xE0 | (code_point >> 12));
+    buffer_ += static_cast<char>(0x80 | ((code_point >> 6) & 0x3F));
+    buffer_ += static_cast<char>(0x80 | (code_point & 0x3F));
+  }
+}
@@ -0,0 +1,55 @@
+#ifndef JSON_SCANNER_H
+#define JSON_SCANNER_H
+
+#include <cstddef>
+#include <map>
+#include <string>
+
+/**
+ * \class JsonScanner
+ * \brief Streaming JSON scanner for API responses, without building a JSON document (DOM).
+ * Only the scalar values and the array sizes of the top-level object are kept, nested values are skipped.
+ * The response can be fed in chunks while it is received, memory usage doesn't depend on the response size.
+ */
+class JsonScanner
+{
+public:
+  JsonScanner();
+  void feed(const char* data, std::size_t length);
+  std::string get_value(const std::string& key) const;
+  std::size_t get_array_size(const std::string& key) const;
+
+private:
+  /**
+   * \enum Capture
+   * \brief What the current string (or literal) is captured for
+   */
+  enum Capture
+  {
+    CAPTURE_NONE = 0, /* Skipped (nested value) */
+    CAPTURE_KEY,      /* Key of the top-level object */
+    CAPTURE_VALUE     /* Scalar value of the top-level object */
+  };
+
+  std::map<std::string, std::string> values_;      /* Scalar values of the top-level object (strings are unescaped) */
+  std::map<std::string, std::size_t> array_sizes_; /* Number of elements of the arrays in the top-level object */
+  std::string key_;                                /* Current key of the top-level object */
+  std::string buffer_;                             /* Captured string or literal so far */
+  Capture capture_;                                /* What the current string (or literal) is captured for */
+  int depth_;                                      /* Nesting depth, the top-level object is depth 1 */
+  bool is_expecting_key_;                          /* Next string in the top-level object is a key */
+  bool in_string_;                                 /* Inside a string */
+  bool in_literal_;                                /* Inside a literal (number, true, false or null) */
+  bool is_escape_;                                 /* Previous character was a backslash */
+  int unicode_digits_;                             /* Remaining hex digits of a \uXXXX escape */
+  unsigned int unicode_value_;                     /* Code point of the \uXXXX escape so far */
+  bool is_counting_;                               /* Inside an array of the top-level object */
+  bool is_element_expected_;                       /* Next value in the array is a new element */
+
+  void scan_string(char c);
+  void end_literal();
+  void begin_value();
+  void append_code_point(unsigned int code_point);
+};
+
+#endif
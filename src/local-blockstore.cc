@@ -0,0 +1,415 @@
+#include "local-blockstore.h"
+#include "file.h"
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <memory>
+
+#ifdef LEGACY_CXX
+#include <experimental/filesystem>
+namespace n_fs = ::std::experimental::filesystem;
+#else
+#include <filesystem>
+namespace n_fs = ::std::filesystem;
+#endif
+
+// Sharding of the flatfs datastore, as stored in the SHARDING file (eg. /repo/flatfs/shard/v1/next-to-last/2)
+static const std::string ShardingPrefix = "/repo/flatfs/shard/v1/";
+// Block files are named after the base32 encoded multihash of the block
+static const char* const BlockExtension = ".data";
+static const char* const Base32Alphabet = "ABCDEFGHIJKLMNOPQRSTUVWXYZ234567";
+static const char* const Base58Alphabet = "123456789ABCDEFGHJKLMNPQRSTUVWXYZabcdefghijkmnopqrstuvwxyz";
+// Multicodec codes of the supported CIDs, and of the identity hash (the digest is the content itself)
+static const std::uint64_t CodecDagPb = 0x70;
+static const std::uint64_t CodecRaw = 0x55;
+static const std::uint64_t MultihashIdentity = 0x00;
+// UnixFS data types that contain file content
+static const std::uint64_t UnixFSRaw = 0;
+static const std::uint64_t UnixFSFile = 2;
+// Limit the depth of the DAG, a file DAG of the IPFS daemon is only a few levels deep
+static const unsigned int MaxDagDepth = 64;
+
+namespace
+{
+  /**
+   * \struct Field
+   * \brief Field of a protobuf message, either a number (varint) or bytes (length-delimited)
+   */
+  struct Field
+  {
+    std::uint64_t number;
+    std::uint64_t wire_type;
+    std::uint64_t value;       /* Value of a varint, or the length of a length-delimited field */
+    const std::uint8_t* begin; /* Value of a length-delimited field */
+    const std::uint8_t* end;
+  };
+
+  /**
+   * Read an unsigned varint, as used by multiformats and protobuf
+   */
+  bool read_varint(const std::uint8_t*& pos, const std::uint8_t* end, std::uint64_t& value)
+  {
+    value = 0;
+    for (unsigned int shift = 0; pos < end && shift < 64; shift += 7)
+    {
+      std::uint8_t byte = *pos++;
+      value |= static_cast<std::uint64_t>(byte & 0x7F) << shift;
+      if ((byte & 0x80) == 0)
+        return true;
+    }
+    return false;
+  }
+
+  /**
+   * Read the next field of a protobuf message, fixed-size fields are skipped
+   */
+  bool read_field(const std::uint8_t*& pos, const std::uint8_t* end, Field& field)
+  {
+    std::uint64_t key = 0;
+    if (!read_varint(pos, end, key))
+      return false;
+    field.number = key >> 3;
+    field.wire_type = key & 0x7;
+    switch (field.wire_type)
+    {
+    case 0:
+      return read_varint(pos, end, field.value);
+    case 1:
+      if (end - pos < 8)
+        return false;
+      pos += 8;
+      return true;
+    case 2:
+      if (!read_varint(pos, end, field.value) || field.value > static_cast<std::uint64_t>(end - pos))
+        return false;
+      field.begin = pos;
+      field.end = pos + field.value;
+      pos = field.end;
+      return true;
+    case 5:
+      if (end - pos < 4)
+        return false;
+      pos += 4;
+      return true;
+    default:
+      return false;
+    }
+  }
+
+  /**
+   * Decode base32 (RFC 4648, without padding), in lower or upper case
+   */
+  bool decode_base32(const std::string& text, std::vector<std::uint8_t>& bytes)
+  {
+    std::uint32_t buffer = 0;
+    int bits = 0;
+    for (char c : text)
+    {
+      int value;
+      if (c >= 'a' && c <= 'z')
+        value = c - 'a';
+      else if (c >= 'A' && c <= 'Z')
+        value = c - 'A';
+      else if (c >= '2' && c <= '7')
+        value = c - '2' + 26;
+      else
+        return false;
+      buffer = (buffer << 5) | static_cast<std::uint32_t>(value);
+      bits += 5;
+      if (bits >= 8)
+      {
+        bits -= 8;
+        bytes.push_back(static_cast<std::uint8_t>(buffer >> bits));
+      }
+    }
+    return true;
+  }
+
+  /**
+   * Decode base58 (bitcoin alphabet)
+   */
+  bool decode_base58(const std::string& text, std::vector<std::uint8_t>& bytes)
+  {
+    std::vector<std::uint8_t> number; // Big-endian
+    for (char c : text)
+    {
+      const char* digit = std::strchr(Base58Alphabet, c);
+      if (c == '\0' || digit == nullptr)
+        return false;
+      unsigned int carry = static_cast<unsigned int>(digit - Base58Alphabet);
+      for (auto it = number.rbegin(); it != number.rend(); ++it)
+      {
+        carry += static_cast<unsigned int>(*it) * 58;
+        *it = static_cast<std::uint8_t>(carry & 0xFF);
+        carry >>= 8;
+      }
+      for (; carry > 0; carry >>= 8)
+        number.insert(number.begin(), static_cast<std::uint8_t>(carry & 0xFF));
+    }
+    // Leading '1' characters are leading zero bytes
+    for (std::size_t i = 0; i < text.size() && text[i] == '1'; ++i)
+      bytes.push_back(0);
+    bytes.insert(bytes.end(), number.begin(), number.end());
+    return true;
+  }
+} // namespace
+
+/**
+ * \brief Constructor, the blocks are only read when a file is requested
+ * \param repo_path Path of the local IPFS repository (see the IPFS repository stats)
+ */
+LocalBlockstore::LocalBlockstore(const std::string& repo_path)
+    : blocks_path_((n_fs::path(repo_path) / "blocks").string()),
+      shard_length_(0)
+{
+  // Other datastores (eg. badger) don't have a SHARDING file, all files are a miss then
+  std::ifstream sharding_file((n_fs::path(blocks_path_) / "SHARDING").string());
+  std::string sharding;
+  if (!(sharding_file >> sharding) || !sharding.starts_with(ShardingPrefix))
+    return;
+  sharding.erase(0, ShardingPrefix.size());
+  std::size_t separator = sharding.find('/');
+  if (separator == std::string::npos)
+    return;
+  std::string shard_func = sharding.substr(0, separator);
+  int shard_length = std::atoi(sharding.c_str() + separator + 1);
+  if ((shard_func == "next-to-last" || shard_func == "prefix" || shard_func == "suffix") && shard_length > 0)
+  {
+    shard_func_ = shard_func;
+    shard_length_ = static_cast<std::size_t>(shard_length);
+  }
+}
+
+/**
+ * \brief Read a UnixFS file from the local repository, the content is passed in chunks (without copying the blocks) while
+ * walking the DAG. Only a plain CID is supported (CIDv0, or CIDv1 in base32 or base58), paths are a miss.
+ * \param cid Content identifier of the file
+ * \param chunk_callback Called for each chunk of the file content, return false to stop reading
+ * \param token Cancellation token, reading stops when cancelled
+ * \param read_length Length of the content that is passed on, when the file is not completely in the local repository
+ * the rest of the content (after read_length bytes) still needs to be fetched via the API
+ * \return true if the file is read (or stopped by the callback/cancelled), false when a block of the file is not in the
+ * local repository (a miss) or is not valid
+ */
+bool LocalBlockstore::read_file(const std::string& cid,
+                                const std::function<bool(const char* data, std::size_t length)>& chunk_callback,
+                                const CancellationToken& token,
+                                std::size_t& read_length) const
+{
+  read_length = 0;
+  std::vector<std::uint8_t> cid_bytes;
+  if (shard_func_.empty() || !decode_cid(cid, cid_bytes))
+    return false;
+  ReadState state = {chunk_callback, token, 0, false};
+  bool is_read = read_block(cid_bytes, 0, 0, state);
+  read_length = state.read_length;
+  return is_read;
+}
+
+/**
+ * Pass the file content of a block and its children on (depth-first, in order), false when a block is missing or is not
+ * part of a file. Every child must contain the size that its parent declares, this limits the DAG to the file size of the root.
+ */
+bool LocalBlockstore::read_block(const std::vector<std::uint8_t>& cid, std::uint64_t expected_size, unsigned int depth, ReadState& state) const
+{
+  if (depth > MaxDagDepth)
+    return false;
+  if (state.token.is_cancelled())
+  {
+    state.is_stopped = true;
+    return true;
+  }
+  // CIDv0 is a plain sha2-256 multihash of a dag-pb block, otherwise: <version><codec><multihash>
+  const std::uint8_t* pos = cid.data();
+  const std::uint8_t* end = cid.data() + cid.size();
+  std::uint64_t codec = CodecDagPb;
+  std::uint64_t version = 0;
+  if (!(cid.size() == 34 && cid[0] == 0x12 && cid[1] == 0x20))
+  {
+    if (!read_varint(pos, end, version) || version != 1 || !read_varint(pos, end, codec))
+      return false;
+  }
+  if (codec != CodecDagPb && codec != CodecRaw)
+    return false;
+  std::vector<std::uint8_t> multihash(pos, end);
+  std::uint64_t hash_code = 0;
+  std::uint64_t digest_length = 0;
+  if (!read_varint(pos, end, hash_code) || !read_varint(pos, end, digest_length) || digest_length != static_cast<std::uint64_t>(end - pos))
+    return false;
+
+  // The content of an identity hash is the digest itself, there is no block file
+  std::unique_ptr<MappedFile> block;
+  const std::uint8_t* block_begin = pos;
+  const std::uint8_t* block_end = end;
+  if (hash_code != MultihashIdentity)
+  {
+    block = std::make_unique<MappedFile>(get_block_path(multihash));
+    if (!block->is_open())
+      return false;
+    block_begin = reinterpret_cast<const std::uint8_t*>(block->data());
+    block_end = block_begin + block->size();
+  }
+  if (codec == CodecRaw)
+  {
+    if (depth > 0 && static_cast<std::uint64_t>(block_end - block_begin) != expected_size)
+      return false;
+    pass_content(block_begin, block_end, state);
+    return true;
+  }
+
+  // dag-pb node: repeated links (field 2, with the child CID as field 1) and the UnixFS data (field 1)
+  std::vector<std::vector<std::uint8_t>> children;
+  const std::uint8_t* data_begin = nullptr;
+  const std::uint8_t* data_end = nullptr;
+  Field field = {};
+  for (pos = block_begin; pos < block_end;)
+  {
+    if (!read_field(pos, block_end, field))
+      return false;
+    if (field.number == 2 && field.wire_type == 2)
+    {
+      Field link_field = {};
+      for (const std::uint8_t* link_pos = field.begin; link_pos < field.end;)
+      {
+        if (!read_field(link_pos, field.end, link_field))
+          return false;
+        if (link_field.number == 1 && link_field.wire_type == 2)
+          children.emplace_back(link_field.begin, link_field.end);
+      }
+    }
+    else if (field.number == 1 && field.wire_type == 2)
+    {
+      data_begin = field.begin;
+      data_end = field.end;
+    }
+  }
+  // UnixFS data: type (field 1), the content of this node (field 2), the file size (field 3) and the content size of each
+  // child (field 4, packed or not). Directories and symlinks are a miss.
+  std::uint64_t type = UnixFSFile + 1;
+  const std::uint8_t* content_begin = nullptr;
+  const std::uint8_t* content_end = nullptr;
+  bool has_file_size = false;
+  std::uint64_t file_size = 0;
+  std::vector<std::uint64_t> block_sizes;
+  for (pos = data_begin; pos != nullptr && pos < data_end;)
+  {
+    if (!read_field(pos, data_end, field))
+      return false;
+    if (field.number == 1 && field.wire_type == 0)
+      type = field.value;
+    else if (field.number == 2 && field.wire_type == 2)
+    {
+      content_begin = field.begin;
+      content_end = field.end;
+    }
+    else if (field.number == 3 && field.wire_type == 0)
+    {
+      has_file_size = true;
+      file_size = field.value;
+    }
+    else if (field.number == 4 && field.wire_type == 0)
+      block_sizes.push_back(field.value);
+    else if (field.number == 4 && field.wire_type == 2)
+    {
+      std::uint64_t block_size = 0;
+      for (const std::uint8_t* size_pos = field.begin; size_pos < field.end; block_sizes.push_back(block_size))
+      {
+        if (!read_varint(size_pos, field.end, block_size))
+          return false;
+      }
+    }
+  }
+  if ((type != UnixFSFile && type != UnixFSRaw) || block_sizes.size() != children.size())
+    return false;
+  std::uint64_t size = static_cast<std::uint64_t>(content_end - content_begin);
+  for (std::uint64_t block_size : block_sizes)
+  {
+    if (block_size > std::numeric_limits<std::uint64_t>::max() - size)
+      return false;
+    size += block_size;
+  }
+  if ((has_file_size && file_size != size) || (depth > 0 && size != expected_size))
+    return false;
+
+  // The content of this node is followed by the content of the children
+  pass_content(content_begin, content_end, state);
+  for (std::size_t index = 0; index < children.size() && !state.is_stopped; ++index)
+  {
+    if (block_sizes[index] > 0 && !read_block(children[index], block_sizes[index], depth + 1, state))
+      return false;
+  }
+  return true;
+}
+
+/**
+ * Pass a chunk of the file content on, the callback can stop reading
+ */
+void LocalBlockstore::pass_content(const std::uint8_t* begin, const std::uint8_t* end, ReadState& state)
+{
+  if (begin == end || state.is_stopped)
+    return;
+  std::size_t length = static_cast<std::size_t>(end - begin);
+  state.read_length += length;
+  if (!state.chunk_callback(reinterpret_cast<const char*>(begin), length))
+    state.is_stopped = true;
+}
+
+/**
+ * Path of a block file: <blocks>/<shard>/<base32 multihash>.data
+ */
+std::string LocalBlockstore::get_block_path(const std::vector<std::uint8_t>& multihash) const
+{
+  std::string key;
+  std::uint32_t buffer = 0;
+  int bits = 0;
+  for (std::uint8_t byte : multihash)
+  {
+    buffer = (buffer << 8) | byte;
+    bits += 8;
+    while (bits >= 5)
+    {
+      bits -= 5;
+      key += Base32Alphabet[(buffer >> bits) & 0x1F];
+    }
+  }
+  if (bits > 0)
+    key += Base32Alphabet[(buffer << (5 - bits)) & 0x1F];
+
+  // Short keys are padded with '_'
+  std::string shard;
+  if (shard_func_ == "prefix")
+  {
+    shard = key.substr(0, shard_length_);
+    shard.append(shard_length_ - shard.size(), '_');
+  }
+  else
+  {
+    std::size_t suffix_length = (shard_func_ == "next-to-last") ? shard_length_ + 1 : shard_length_;
+    std::string padded = (key.size() < suffix_length) ? std::string(suffix_length - key.size(), '_') + key : key;
+    shard = padded.substr(padded.size() - suffix_length, shard_length_);
+  }
+  return (n_fs::path(blocks_path_) / shard / (key + BlockExtension)).string();
+}
+
+/**
+ * Decode a CID string to its binary form, a CIDv0 (Qm...) is a plain multihash
+ */
+bool LocalBlockstore::decode_cid(const std::string& cid, std::vector<std::uint8_t>& bytes)
+{
+  if (cid.size() == 46 && cid.starts_with("Qm"))
+    return decode_base58(cid, bytes);
+  if (cid.size() < 2)
+    return false;
+  // Multibase prefix
+  switch (cid[0])
+  {
+  case 'b':
+  case 'B':
+    return decode_base32(cid.substr(1), bytes);
+  case 'z':
+    return decode_base58(cid.substr(1), bytes);
+  default:
+    return false;
+  }
+}
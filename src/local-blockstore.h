@@ -0,0 +1,50 @@
+#ifndef LOCAL_BLOCKSTORE_H
+#define LOCAL_BLOCKSTORE_H
+
+#include "executor.h"
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+/**
+ * \class LocalBlockstore
+ * \brief Read-only access to the blocks of the local IPFS repository (flatfs datastore), bypassing the HTTP API.
+ * The content of a UnixFS file is passed on while the DAG is walked, so the first chunk is available directly.
+ * When a block is not in the local repository, the rest of the file can be requested via the API instead.
+ * Block hashes are not verified, like the IPFS daemon doesn't verify blocks read from its own datastore by default.
+ */
+class LocalBlockstore
+{
+public:
+  explicit LocalBlockstore(const std::string& repo_path);
+  bool read_file(const std::string& cid,
+                 const std::function<bool(const char* data, std::size_t length)>& chunk_callback,
+                 const CancellationToken& token,
+                 std::size_t& read_length) const;
+
+private:
+  /**
+   * \struct ReadState
+   * \brief State of reading a file, shared by all blocks of the file
+   */
+  struct ReadState
+  {
+    const std::function<bool(const char* data, std::size_t length)>& chunk_callback;
+    const CancellationToken& token;
+    std::size_t read_length; /* Length of the content that is passed on */
+    bool is_stopped;         /* Stopped by the callback, or cancelled */
+  };
+
+  std::string blocks_path_;  /* Directory of the block files */
+  std::string shard_func_;   /* Sharding function of the datastore: next-to-last, prefix or suffix */
+  std::size_t shard_length_; /* Length of the shard directory names */
+
+  bool read_block(const std::vector<std::uint8_t>& cid, std::uint64_t expected_size, unsigned int depth, ReadState& state) const;
+  static void pass_content(const std::uint8_t* begin, const std::uint8_t* end, ReadState& state);
+  std::string get_block_path(const std::vector<std::uint8_t>& multihash) const;
+  static bool decode_cid(const std::string& cid, std::vector<std::uint8_t>& bytes);
+};
+
+#endif
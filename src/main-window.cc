@@ -2,6 +2,7 @@
 
 #include "menu.h"
 #include "project_config.h"
+#include <algorithm>
 #include <cstdint>
 #include <gdk-pixbuf/gdk-pixbuf.h>
 #include <giomm/file.h>
@@ -21,6 +22,9 @@
 #include <string.h>
 #include <whereami.h>
 
+// Memory limit of the history snapshots, the snapshots of the entries furthest away from the current entry are dropped first
+static const std::size_t HistorySnapshotsMaxBytes = 128 * 1024 * 1024;
+
 #if defined(__APPLE__)
 static void osx_will_quit_cb(__attribute__((unused)) const GtkosxApplication* app, __attribute__((unused)) gpointer data)
 {
@@ -28,7 +32,7 @@ static void osx_will_quit_cb(__attribute__((unused)) const GtkosxApplication* ap
 }
 #endif
 
-MainWindow::MainWindow(const std::string& timeout)
+MainWindow::MainWindow(const ApiAddress& api_address, const std::string& timeout)
     : accel_group(Gtk::AccelGroup::create()),
       settings(),
       brightness_adjustment(Gtk::Adjustment::create(1.0, 0.0, 1.0, 0.05, 0.1)),
@@ -100,7 +104,7 @@ MainWindow::MainWindow(const std::string& timeout)
       reader_view_label("Reader View"),
       icon_theme_label("Active Theme"),
       // Private members
-      middleware_(*this, timeout),
+      middleware_(*this, api_address, timeout),
       app_name_("LibreWeb Browser"),
       use_current_gtk_icon_theme_(false), // Use LibreWeb icon theme or the GTK icons
       icon_theme_flat_("flat"),
@@ -120,7 +124,8 @@ MainWindow::MainWindow(const std::string& timeout)
       brightness_scale_(1.0),
       use_dark_theme_(false),
       is_reader_view_enabled_(true),
-      current_history_index_(0)
+      current_history_index_(0),
+      is_current_document_complete_(false)
 {
   set_title(app_name_);
   set_default_size(1000, 800);
@@ -205,20 +210,19 @@ void MainWindow::pre_request(
     set_title(title + " - " + app_name_);
   else
     set_title(app_name_);
+  // Keep the page that is left, so it can be shown directly when going back (back/forward calls did this already)
+  if (!is_history_request)
+    save_history_snapshot();
+  reset_current_document();
   if (is_disable_editor && is_editor_enabled())
     disable_edit();
 
   // Do not insert history back/forward calls into the history (again)
   if (!is_history_request && !path.empty())
   {
-    if (history_.empty())
-    {
-      history_.push_back(path);
-      current_history_index_ = history_.size() - 1;
-    }
-    else if (history_.back().compare(path) != 0)
+    if (history_.empty() || history_.back().path.compare(path) != 0)
     {
-      history_.push_back(path);
+      history_.push_back({path, {}, nullptr, 0, 0});
       current_history_index_ = history_.size() - 1;
     }
   }
@@ -275,39 +279,133 @@ void MainWindow::refresh_request()
 
 /**
  * \brief Show home page
+ * \param generation Generation number of the request, the result of an older request is dropped
  */
-void MainWindow::show_homepage()
+void MainWindow::show_homepage(std::size_t generation)
 {
+  if (!middleware_.is_request_current(generation))
+    return;
+  reset_current_document();
   draw_primary.show_homepage();
 }
 
 /**
  * \brief Set plain text
- * \param content content string
+ * \param content content buffer
+ * \param generation Generation number of the request, the result of an older request is dropped
+ */
+void MainWindow::set_text(ContentBuffer content, std::size_t generation)
+{
+  if (!middleware_.is_request_current(generation))
+    return;
+  reset_current_document();
+  draw_primary.set_text(*content);
+}
+
+/**
+ * \brief Set markdown document (common mark) on primary window.
+ * The ToC is filled-in while the document is drawn (see on_headings_added()).
+ * \param document Compiled markdown document
+ * \param generation Generation number of the request, the result of an older request is dropped
  */
-void MainWindow::set_text(const Glib::ustring& content)
+void MainWindow::set_document(std::shared_ptr<const RenderDocument> document, std::size_t generation)
 {
-  draw_primary.set_text(content);
+  if (!middleware_.is_request_current(generation))
+    return;
+  show_document(std::move(document));
 }
 
 /**
- * \brief Set markdown document (common mark) on primary window. cmark_node pointer will be freed automatically.
- * And set the ToC.
- * \param root_node cmark root data struct
+ * \brief Replace the document on the primary window, the ToC is filled-in while the document is drawn
+ * \param document Compiled markdown document
  */
-void MainWindow::set_document(cmark_node* root_node)
+void MainWindow::show_document(std::shared_ptr<const RenderDocument> document)
 {
-  draw_primary.set_document(root_node);
-  set_table_of_contents(draw_primary.get_headings());
+  current_document_parts_.assign(1, document);
+  is_current_document_complete_ = true;
+  toc_tree_model->clear();
+  draw_primary.set_document(std::move(document));
+}
+
+/**
+ * \brief Append the finished part of a document that is still being received (on the primary window).
+ * \param document Compiled markdown document, containing only the finished top-level blocks
+ * \param is_first_part Set to true for the first part, which replaces the current document
+ * \param is_last_part Set to true for the last part, the document is complete
+ * \param generation Generation number of the request, the result of an older request is dropped
+ */
+void MainWindow::append_document(std::shared_ptr<const RenderDocument> document, bool is_first_part, bool is_last_part, std::size_t generation)
+{
+  if (!middleware_.is_request_current(generation))
+    return;
+  if (is_first_part)
+  {
+    show_document(document);
+  }
+  else
+  {
+    current_document_parts_.push_back(document);
+    draw_primary.append_document(document);
+  }
+  is_current_document_complete_ = is_last_part;
+}
+
+/**
+ * \brief Set the complete document after its parts are appended (see append_document()), only the blocks that
+ * are not displayed yet are drawn.
+ * \param document Compiled markdown document
+ * \param generation Generation number of the request, the result of an older request is dropped
+ */
+void MainWindow::finish_document(std::shared_ptr<const RenderDocument> document, std::size_t generation)
+{
+  if (!middleware_.is_request_current(generation))
+    return;
+  current_document_parts_.assign(1, document);
+  is_current_document_complete_ = true;
+  std::size_t first_changed_heading = draw_primary.update_document(std::move(document));
+  remove_table_of_contents_rows(toc_tree_model->children(), first_changed_heading);
+  set_table_of_contents(draw_primary, first_changed_heading);
+}
+
+/**
+ * \brief Signal handler when headings are drawn on the primary window, add them to the ToC
+ * \param first_index Index of the first new heading
+ */
+void MainWindow::on_headings_added(std::size_t first_index)
+{
+  set_table_of_contents(draw_primary, first_index);
+}
+
+/**
+ * \brief Set the compiled editor content on the secondary (preview) window and update the ToC.
+ * Stale results are dropped.
+ * \param document Compiled markdown document
+ * \param generation Generation number of the editor snapshot this document was parsed from
+ */
+void MainWindow::set_preview_document(std::shared_ptr<const RenderDocument> document, std::size_t generation)
+{
+  // The editor content changed again in the meantime or the editor is closed, drop this result
+  if (is_editor_enabled() && middleware_.is_preview_current(generation))
+  {
+    // Show the document as a preview on the right side text-view panel
+    std::size_t first_changed_heading = draw_secondary.update_document(std::move(document));
+    // Only replace the ToC rows of the changed headings
+    remove_table_of_contents_rows(toc_tree_model->children(), first_changed_heading);
+    set_table_of_contents(draw_secondary, first_changed_heading);
+  }
 }
 
 /**
  * \brief Set message with optionally additional details
  * \param message Message string
  * \param details Details string
+ * \param generation Generation number of the request, the result of an older request is dropped
  */
-void MainWindow::set_message(const Glib::ustring& message, const Glib::ustring& details)
+void MainWindow::set_message(const Glib::ustring& message, const Glib::ustring& details, std::size_t generation)
 {
+  if (!middleware_.is_request_current(generation))
+    return;
+  reset_current_document();
   draw_primary.set_message(message, details);
 }
 
@@ -317,7 +415,9 @@ void MainWindow::set_message(const Glib::ustring& message, const Glib::ustring&
 void MainWindow::update_status_popover_and_icon()
 {
   std::string networkStatus;
-  std::size_t nrOfPeers = middleware_.get_ipfs_number_of_peers();
+  // All values are from the same status update
+  std::shared_ptr<const IPFSStatus> status = middleware_.get_ipfs_status();
+  std::size_t nrOfPeers = status->number_of_peers;
   // Update status icon
   if (nrOfPeers > 0)
   {
@@ -345,11 +445,11 @@ void MainWindow::update_status_popover_and_icon()
   }
   connectivity_status_label.set_markup("<b>" + networkStatus + "</b>");
   peers_status_label.set_text(std::to_string(nrOfPeers));
-  repo_size_status_label.set_text(std::to_string(middleware_.get_ipfs_repo_size()) + " MB");
-  repo_path_status_label.set_text(middleware_.get_ipfs_repo_path());
-  network_incoming_status_label.set_text(middleware_.get_ipfs_incoming_rate());
-  network_outgoing_status_label.set_text(middleware_.get_ipfs_outgoing_rate());
-  ipfs_version_status_label.set_text(middleware_.get_ipfs_version());
+  repo_size_status_label.set_text(std::to_string(status->repo_size) + " MB");
+  repo_path_status_label.set_text(status->repo_path);
+  network_incoming_status_label.set_text(status->incoming_rate);
+  network_outgoing_status_label.set_text(status->outgoing_rate);
+  ipfs_version_status_label.set_text(status->version);
 }
 
 /**
@@ -400,6 +500,9 @@ void MainWindow::load_stored_settings()
     brightness_scale_ = settings->get_double("brightness");
     use_dark_theme_ = settings->get_boolean("dark-theme");
     is_reader_view_enabled_ = settings->get_boolean("reader-view");
+    middleware_.set_document_cache_limit(static_cast<std::size_t>(std::max(settings->get_int("document-cache-size"), 0)) * 1024 * 1024);
+    middleware_.set_disk_cache_limit(static_cast<std::size_t>(std::max(settings->get_int("disk-cache-size"), 0)) * 1024 * 1024);
+    draw_primary.set_undo_history_limit(static_cast<std::size_t>(std::max(settings->get_int("undo-history-size"), 1)) * 1024 * 1024);
     switch (wrap_mode_)
     {
     case Gtk::WRAP_NONE:
@@ -973,6 +1076,7 @@ void MainWindow::init_signals()
 {
   // Window signals
   signal_delete_event().connect(sigc::mem_fun(this, &MainWindow::delete_window));
+  signal_window_state_event().connect(sigc::mem_fun(this, &MainWindow::window_state_changed));
   draw_primary.signal_size_allocate().connect(sigc::mem_fun(this, &MainWindow::on_size_alloc));
 
   // Table of contents
@@ -1005,6 +1109,7 @@ void MainWindow::init_signals()
   source_code_dialog.signal_response().connect(sigc::mem_fun(source_code_dialog, &SourceCodeDialog::hide_dialog)); /*!< Close source code dialog */
   menu.about.connect(sigc::mem_fun(about, &About::show_about));                                                    /*!< Display about dialog */
   draw_primary.source_code.connect(sigc::mem_fun(this, &MainWindow::show_source_code_dialog));                     /*!< Open source code dialog */
+  draw_primary.headings_added.connect(sigc::mem_fun(this, &MainWindow::on_headings_added));                        /*!< Fill-in ToC while drawing */
   about.signal_response().connect(sigc::mem_fun(about, &About::hide_about));                                       /*!< Close about dialog */
   address_bar.signal_activate().connect(sigc::mem_fun(this, &MainWindow::address_bar_activate)); /*!< User pressed enter the address bar */
   open_toc_button.signal_clicked().connect(sigc::mem_fun(this, &MainWindow::show_toc));          /*!< Button for showing Table of Contents */
@@ -1080,6 +1185,16 @@ void MainWindow::init_mac_os()
 #endif
 }
 
+/**
+ * \brief Called when the window state is changed, the IPFS status is updated less often while the window is hidden
+ */
+bool MainWindow::window_state_changed(GdkEventWindowState* window_state_event)
+{
+  bool is_hidden = (window_state_event->new_window_state & (GDK_WINDOW_STATE_ICONIFIED | GDK_WINDOW_STATE_WITHDRAWN)) != 0;
+  middleware_.set_status_visible(!is_hidden);
+  return false;
+}
+
 /**
  * \brief Called when Window is closed/exited
  */
@@ -1285,12 +1400,12 @@ void MainWindow::on_toc_row_activated(const Gtk::TreeModel::Path& path, __attrib
     const auto row = *iter;
     if (row[toc_columns.col_valid])
     {
-      Gtk::TextIter textIter = row[toc_columns.col_iter];
-      // Scroll to to mark iterator
-      if (is_editor_enabled())
-        draw_secondary.scroll_to(textIter);
-      else
-        draw_primary.scroll_to(textIter);
+      unsigned int index = row[toc_columns.col_index];
+      Draw& draw = (is_editor_enabled()) ? draw_secondary : draw_primary;
+      const std::vector<Heading>& headings = draw.get_headings();
+      // Scroll to the current position of the heading
+      if (index < headings.size())
+        draw.scroll_to(draw.get_buffer()->get_iter_at_offset(headings[index].offset));
     }
   }
 }
@@ -1445,7 +1560,7 @@ void MainWindow::edit()
   if (!is_editor_enabled())
     enable_edit();
 
-  draw_primary.set_text(middleware_.get_content());
+  draw_primary.set_text(*middleware_.get_content());
   // Set title
   set_title("Untitled * - " + app_name_);
 }
@@ -1569,7 +1684,7 @@ void MainWindow::on_save_as_dialog_response(int response_id, Gtk::FileChooserDia
 void MainWindow::publish()
 {
   int result = Gtk::RESPONSE_YES; // By default continue
-  if (middleware_.get_content().empty())
+  if (middleware_.get_content()->empty())
   {
     Gtk::MessageDialog dialog(*this, "Are you sure you want to publish <b>empty</b> content?", true, Gtk::MESSAGE_QUESTION, Gtk::BUTTONS_YES_NO);
     dialog.set_title("Are you sure?");
@@ -1795,8 +1910,9 @@ void MainWindow::back()
 {
   if (current_history_index_ > 0)
   {
+    save_history_snapshot();
     current_history_index_--;
-    middleware_.do_request(history_.at(current_history_index_), true, true);
+    show_history_entry();
   }
 }
 
@@ -1804,28 +1920,142 @@ void MainWindow::forward()
 {
   if (current_history_index_ < history_.size() - 1)
   {
+    save_history_snapshot();
     current_history_index_++;
-    middleware_.do_request(history_.at(current_history_index_), true, true);
+    show_history_entry();
+  }
+}
+
+/**
+ * \brief Store a snapshot of the displayed page in the current history entry, so it can be shown again without
+ * fetching, parsing and drawing it again. Only a complete document can be stored (not the editor, a message or
+ * a document that is still being received).
+ */
+void MainWindow::save_history_snapshot()
+{
+  if (current_history_index_ >= history_.size())
+    return;
+  HistoryEntry& entry = history_[current_history_index_];
+  if (is_editor_enabled() || !is_current_document_complete_)
+  {
+    // The snapshot (if any) is outdated
+    entry.document_parts.clear();
+    entry.content.reset();
+    entry.snapshot_bytes = 0;
+    return;
+  }
+  entry.document_parts = current_document_parts_;
+  entry.content = middleware_.get_content();
+  entry.scroll_offset = draw_primary.get_scroll_offset();
+  entry.snapshot_bytes = sizeof(HistoryEntry) + entry.content->size();
+  for (const auto& document : entry.document_parts)
+  {
+    entry.snapshot_bytes += document->get_memory_usage();
   }
+  evict_history_snapshots();
+}
+
+/**
+ * \brief Drop the snapshots of the history entries that are the furthest away from the current entry,
+ * until the snapshots are within the memory limit
+ */
+void MainWindow::evict_history_snapshots()
+{
+  std::size_t total_bytes = 0;
+  for (const HistoryEntry& entry : history_)
+  {
+    total_bytes += entry.snapshot_bytes;
+  }
+  while (total_bytes > HistorySnapshotsMaxBytes)
+  {
+    std::size_t furthest_index = current_history_index_;
+    std::size_t furthest_distance = 0;
+    for (std::size_t index = 0; index < history_.size(); ++index)
+    {
+      std::size_t distance = (index > current_history_index_) ? index - current_history_index_ : current_history_index_ - index;
+      if (history_[index].snapshot_bytes > 0 && distance >= furthest_distance)
+      {
+        furthest_index = index;
+        furthest_distance = distance;
+      }
+    }
+    HistoryEntry& entry = history_[furthest_index];
+    if (entry.snapshot_bytes == 0)
+      break;
+    total_bytes -= entry.snapshot_bytes;
+    entry.document_parts.clear();
+    entry.content.reset();
+    entry.snapshot_bytes = 0;
+  }
+}
+
+/**
+ * \brief Show the current history entry, directly from its snapshot if available.
+ * Otherwise the page is requested again.
+ */
+void MainWindow::show_history_entry()
+{
+  const HistoryEntry& entry = history_.at(current_history_index_);
+  if (entry.document_parts.empty())
+  {
+    middleware_.do_request(entry.path, true, true);
+    return;
+  }
+  // Copy the snapshot, the entry is changed when the page is left again
+  std::vector<std::shared_ptr<const RenderDocument>> document_parts = entry.document_parts;
+  int scroll_offset = entry.scroll_offset;
+  middleware_.restore_request(entry.path, entry.content);
+  show_document(document_parts.front());
+  for (std::size_t part = 1; part < document_parts.size(); ++part)
+  {
+    current_document_parts_.push_back(document_parts[part]);
+    draw_primary.append_document(document_parts[part]);
+  }
+  draw_primary.scroll_to_offset(scroll_offset);
+}
+
+/**
+ * \brief Forget the displayed document of the previous request, it is not a complete document (anymore)
+ */
+void MainWindow::reset_current_document()
+{
+  current_document_parts_.clear();
+  is_current_document_complete_ = false;
 }
 
 /**
  * \brief Fill-in table of contents and show
+ * \param draw Text view containing the document
+ * \param begin Index of the first heading to add, the headings before are already in the ToC
  */
-void MainWindow::set_table_of_contents(const std::vector<Glib::RefPtr<Gtk::TextMark>>& headings)
+void MainWindow::set_table_of_contents(const Draw& draw, std::size_t begin)
 {
+  const std::vector<Heading>& headings = draw.get_headings();
   Gtk::TreeRow heading1Row, heading2Row, heading3Row, heading4Row, heading5Row;
   int previousLevel = 1; // Default heading 1
-  for (const Glib::RefPtr<Gtk::TextMark>& headerMark : headings)
+  if (begin > 0)
   {
-    Glib::ustring heading = static_cast<char*>(headerMark->get_data("name"));
-    auto level = reinterpret_cast<std::intptr_t>(headerMark->get_data("level"));
+    // Continue after the last rows that are already added
+    Gtk::TreeRow* headingRows[] = {&heading1Row, &heading2Row, &heading3Row, &heading4Row, &heading5Row};
+    for (std::size_t i = 0; i < 5; ++i)
+    {
+      const Gtk::TreeNodeChildren& children = (i == 0) ? toc_tree_model->children() : headingRows[i - 1]->children();
+      if (children.empty())
+        break;
+      *headingRows[i] = children[children.size() - 1];
+      previousLevel = (*headingRows[i])[toc_columns.col_level];
+    }
+  }
+  for (std::size_t i = begin; i < headings.size(); ++i)
+  {
+    Glib::ustring heading = draw.get_heading_title(headings[i]);
+    int level = headings[i].level;
     switch (level)
     {
     case 1:
     {
       heading1Row = *(toc_tree_model->append());
-      heading1Row[toc_columns.col_iter] = headerMark->get_iter();
+      heading1Row[toc_columns.col_index] = static_cast<unsigned int>(i);
       heading1Row[toc_columns.col_level] = level;
       heading1Row[toc_columns.col_heading] = heading;
       heading1Row[toc_columns.col_valid] = true;
@@ -1850,7 +2080,7 @@ void MainWindow::set_table_of_contents(const std::vector<Glib::RefPtr<Gtk::TextM
         heading1Row[toc_columns.col_valid] = false;
       }
       heading2Row = *(toc_tree_model->append(heading1Row.children()));
-      heading2Row[toc_columns.col_iter] = headerMark->get_iter();
+      heading2Row[toc_columns.col_index] = static_cast<unsigned int>(i);
       heading2Row[toc_columns.col_level] = level;
       heading2Row[toc_columns.col_heading] = heading;
       heading2Row[toc_columns.col_valid] = true;
@@ -1874,7 +2104,7 @@ void MainWindow::set_table_of_contents(const std::vector<Glib::RefPtr<Gtk::TextM
         heading2Row[toc_columns.col_valid] = false;
       }
       heading3Row = *(toc_tree_model->append(heading2Row.children()));
-      heading3Row[toc_columns.col_iter] = headerMark->get_iter();
+      heading3Row[toc_columns.col_index] = static_cast<unsigned int>(i);
       heading3Row[toc_columns.col_level] = level;
       heading3Row[toc_columns.col_heading] = heading;
       heading3Row[toc_columns.col_valid] = true;
@@ -1897,7 +2127,7 @@ void MainWindow::set_table_of_contents(const std::vector<Glib::RefPtr<Gtk::TextM
         heading3Row[toc_columns.col_valid] = false;
       }
       heading4Row = *(toc_tree_model->append(heading3Row.children()));
-      heading4Row[toc_columns.col_iter] = headerMark->get_iter();
+      heading4Row[toc_columns.col_index] = static_cast<unsigned int>(i);
       heading4Row[toc_columns.col_level] = level;
       heading4Row[toc_columns.col_heading] = heading;
       heading4Row[toc_columns.col_valid] = true;
@@ -1919,7 +2149,7 @@ void MainWindow::set_table_of_contents(const std::vector<Glib::RefPtr<Gtk::TextM
         heading4Row[toc_columns.col_valid] = false;
       }
       heading5Row = *(toc_tree_model->append(heading4Row.children()));
-      heading5Row[toc_columns.col_iter] = headerMark->get_iter();
+      heading5Row[toc_columns.col_index] = static_cast<unsigned int>(i);
       heading5Row[toc_columns.col_level] = level;
       heading5Row[toc_columns.col_heading] = heading;
       heading5Row[toc_columns.col_valid] = true;
@@ -1936,7 +2166,7 @@ void MainWindow::set_table_of_contents(const std::vector<Glib::RefPtr<Gtk::TextM
         heading5Row[toc_columns.col_valid] = false;
       }
       auto heading6Row = *(toc_tree_model->append(heading5Row.children()));
-      heading6Row[toc_columns.col_iter] = headerMark->get_iter();
+      heading6Row[toc_columns.col_index] = static_cast<unsigned int>(i);
       heading6Row[toc_columns.col_level] = level;
       heading6Row[toc_columns.col_heading] = heading;
       heading6Row[toc_columns.col_valid] = true;
@@ -1952,6 +2182,37 @@ void MainWindow::set_table_of_contents(const std::vector<Glib::RefPtr<Gtk::TextM
   toc_tree_view.expand_all();
 }
 
+/**
+ * \brief Remove the ToC rows of the headings starting from the given heading index, including the
+ * "missing heading" rows that are left without any children.
+ * \param children Rows to check, starting from the last row
+ * \param first_index Index of the first heading to remove
+ */
+void MainWindow::remove_table_of_contents_rows(const Gtk::TreeNodeChildren& children, std::size_t first_index)
+{
+  while (!children.empty())
+  {
+    Gtk::TreeRow row = children[children.size() - 1];
+    if (row[toc_columns.col_valid])
+    {
+      unsigned int index = row[toc_columns.col_index];
+      if (index < first_index)
+      {
+        // Rows before this row are kept as well, only the children might need to be removed
+        remove_table_of_contents_rows(row.children(), first_index);
+        break;
+      }
+    }
+    else
+    {
+      remove_table_of_contents_rows(row.children(), first_index);
+      if (!row.children().empty())
+        break;
+    }
+    toc_tree_model->erase(row);
+  }
+}
+
 /**
  * \brief Determing if browser is installed to the installation directory at runtime
  * \return true if the current running process is installed (to the installed prefix path)
@@ -1997,6 +2258,7 @@ bool MainWindow::is_installed()
  */
 void MainWindow::enable_edit()
 {
+  reset_current_document();
   // Inform the Draw class that we are creating a new document,
   // will apply change some textview setting changes
   draw_primary.new_document();
@@ -2050,6 +2312,8 @@ void MainWindow::disable_edit()
     scrolled_window_secondary.hide();
     // Disconnect text changed signal
     text_changed_signal_handler_.disconnect();
+    // Drop any pending or in-flight preview
+    middleware_.discard_preview();
     // Disable monospace
     draw_primary.set_monospace(false);
     // Re-apply settings on primary window
@@ -2204,22 +2468,13 @@ void MainWindow::show_notification(const Glib::ustring& title, const Glib::ustri
   get_application()->send_notification(notification);
 }
 
+/**
+ * \brief Triggered on every editor text change. Only queues a snapshot of the editor content,
+ * parsing & rendering of the preview is done by the preview thread (see set_preview_document()).
+ */
 void MainWindow::editor_changed_text()
 {
-  // TODO: Just execute the code below in a signal_idle call?
-  // So it will never block the GUI thread. Or is this already running in another context
-
-  // Clear table of contents (ToC)
-  toc_tree_model->clear();
-  // Retrieve text from editor and parse the markdown contents
-  middleware_.set_content(draw_primary.get_text());
-  cmark_node* doc = middleware_.parse_content();
-  /* // Can be enabled to show the markdown format in terminal:
-  std::string md = Parser::render_markdown(doc);
-  std::cout << "Markdown:\n" << md << std::endl;*/
-  // Show the document as a preview on the right side text-view panel
-  draw_secondary.set_document(doc);
-  set_table_of_contents(draw_secondary.get_headings());
+  middleware_.do_preview(draw_primary.get_text());
 }
 
 /**
@@ -2227,7 +2482,7 @@ void MainWindow::editor_changed_text()
  */
 void MainWindow::show_source_code_dialog()
 {
-  source_code_dialog.set_text(middleware_.get_content());
+  source_code_dialog.set_text(*middleware_.get_content());
   source_code_dialog.run();
 }
 
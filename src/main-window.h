@@ -40,12 +40,25 @@
 #include <gtkmm/treeview.h>
 #include <gtkmm/window.h>
 #include <sigc++/connection.h>
+#include <memory>
 #include <string>
+#include <vector>
 #if defined(__APPLE__)
 #include <gtkosxapplication.h>
 #endif
 
-struct cmark_node;
+/**
+ * \struct HistoryEntry
+ * \brief Visited page, with a snapshot of the displayed document (if available) so it can be shown again directly
+ */
+struct HistoryEntry
+{
+  std::string path;
+  std::vector<std::shared_ptr<const RenderDocument>> document_parts; /* Displayed document (parts), empty if no snapshot */
+  ContentBuffer content;                                             /* Content of the document (not parsed), shared */
+  int scroll_offset;                                                 /* Character offset of the first visible line */
+  std::size_t snapshot_bytes;                                        /* Memory usage of the snapshot */
+};
 
 /**
  * \class MainWindow
@@ -55,21 +68,25 @@ class MainWindow : public Gtk::Window
 {
 public:
   static const int DefaultFontSize = 10;
-  explicit MainWindow(const std::string& timeout);
+  explicit MainWindow(const ApiAddress& api_address, const std::string& timeout);
   void pre_request(const std::string& path, const std::string& title, bool is_set_address_bar, bool is_history_request, bool is_disable_editor);
   void post_write(const std::string& path, const std::string& title, bool is_set_address_and_title);
   void started_request();
   void finished_request();
   void refresh_request();
-  void show_homepage();
-  void set_text(const Glib::ustring& content);
-  void set_document(cmark_node* root_node);
-  void set_message(const Glib::ustring& message, const Glib::ustring& details = "");
+  void show_homepage(std::size_t generation);
+  void set_text(ContentBuffer content, std::size_t generation);
+  void set_document(std::shared_ptr<const RenderDocument> document, std::size_t generation);
+  void append_document(std::shared_ptr<const RenderDocument> document, bool is_first_part, bool is_last_part, std::size_t generation);
+  void finish_document(std::shared_ptr<const RenderDocument> document, std::size_t generation);
+  void set_preview_document(std::shared_ptr<const RenderDocument> document, std::size_t generation);
+  void set_message(const Glib::ustring& message, const Glib::ustring& details, std::size_t generation);
   void update_status_popover_and_icon();
 
 protected:
   // Signal handlers
   bool delete_window(GdkEventAny* any_event);
+  bool window_state_changed(GdkEventWindowState* window_state_event);
   void cut();
   void copy();
   void paste();
@@ -77,6 +94,7 @@ protected:
   void selectAll();
   void on_size_alloc(const Gdk::Rectangle& allocation);
   void on_toc_row_activated(const Gtk::TreeModel::Path& path, Gtk::TreeViewColumn* column);
+  void on_headings_added(std::size_t first_index);
   void new_doc();
   void open();
   void open_and_edit();
@@ -319,7 +337,9 @@ private:
   bool is_reader_view_enabled_;
   std::string current_file_saved_path_;
   std::size_t current_history_index_;
-  std::vector<std::string> history_;
+  std::vector<HistoryEntry> history_;
+  std::vector<std::shared_ptr<const RenderDocument>> current_document_parts_; /* Displayed document (parts) of the request */
+  bool is_current_document_complete_;                                         /* Are all the document parts displayed */
   sigc::connection text_changed_signal_handler_;
 
   void load_stored_settings();
@@ -334,7 +354,13 @@ private:
   void init_signals();
   void init_mac_os();
   bool is_installed();
-  void set_table_of_contents(const std::vector<Glib::RefPtr<Gtk::TextMark>>& headings);
+  void set_table_of_contents(const Draw& draw, std::size_t begin = 0);
+  void remove_table_of_contents_rows(const Gtk::TreeNodeChildren& children, std::size_t first_index);
+  void show_document(std::shared_ptr<const RenderDocument> document);
+  void save_history_snapshot();
+  void evict_history_snapshots();
+  void show_history_entry();
+  void reset_current_document();
   void enable_edit();
   void disable_edit();
   bool is_editor_enabled();
@@ -1,3 +1,4 @@
+#include "api-transport.h"
 #include "ipfs-daemon.h"
 #include "main-window.h"
 #include "option-group.h"
@@ -6,6 +7,7 @@
 #include <gtkmm/application.h>
 #include <iomanip>
 #include <iostream>
+#include <stdexcept>
 #include <sys/types.h>
 #include <unistd.h>
 
@@ -39,6 +41,16 @@ int main(int argc, char* argv[])
     std::cerr << "ERROR: Parse failure: " << error.what() << std::endl;
     exit(EXIT_FAILURE);
   }
+  ApiAddress api_address;
+  try
+  {
+    api_address = ApiAddress::parse(group.api);
+  }
+  catch (const std::invalid_argument& error)
+  {
+    std::cerr << "ERROR: " << error.what() << std::endl;
+    exit(EXIT_FAILURE);
+  }
 
   // The default is to start the IPFS Daemon
   if (group.disable_ipfs_daemon)
@@ -59,6 +71,6 @@ int main(int argc, char* argv[])
   }
 
   // Run the GTK main window in the main thread
-  MainWindow main_window(group.timeout);
+  MainWindow main_window(api_address, group.timeout);
   return app->run(main_window);
 }
@@ -1,12 +1,19 @@
 #include "md-parser.h"
 
+#include <algorithm>
 #include <cmark-gfm-core-extensions.h>
+#include <cstring>
 #include <filesystem>
 #include <node.h>
 #include <stdexcept>
 #include <syntax_extension.h>
 
 static const int Options = CMARK_OPT_STRIKETHROUGH_DOUBLE_TILDE;
+// Number of bytes fed to the parser at once, before checking for cancellation
+static const std::size_t ParseChunkSize = 64 * 1024;
+// FNV-1a (64-bit) hash constants
+static const std::uint64_t FnvOffsetBasis = 14695981039346656037ULL;
+static const std::uint64_t FnvPrime = 1099511628211ULL;
 
 /// Meyers Singleton
 Parser::Parser() = default;
@@ -31,24 +38,100 @@ Parser& Parser::get_instance()
  */
 cmark_node* Parser::parse_content(const Glib::ustring& content)
 {
-  const char* data = content.c_str();
+  return parse_content(content.data(), content.bytes());
+}
+
+/**
+ * \brief Parse markdown from a character buffer (doesn't need to be null-terminated).
+ * Note: Do not forgot to execute: cmark_node_free(document); when you are done with the doc.
+ * \param data Pointer to the content
+ * \param length Length of the content in bytes
+ * \return AST structure (of type cmark_node)
+ */
+cmark_node* Parser::parse_content(const char* data, std::size_t length)
+{
+  // Modified version of cmark_parse_document() in blocks.c
+  cmark_parser* parser = create_parser();
+  cmark_node* document;
+  cmark_parser_feed(parser, data, length);
+  document = cmark_parser_finish(parser);
+  cmark_parser_free(parser);
+  return document;
+}
+
+/**
+ * \brief Parse markdown file from string content, the parsing stops when it is cancelled.
+ * Note: Do not forgot to execute: cmark_node_free(document); when you are done with the doc.
+ * \param content Content as string
+ * \param token Cancellation token (eg. of the request)
+ * \return AST structure (of type cmark_node), nullptr when cancelled
+ */
+cmark_node* Parser::parse_content(const Glib::ustring& content, const CancellationToken& token)
+{
+  return parse_content(content.data(), content.bytes(), token);
+}
+
+/**
+ * \brief Parse markdown from a character buffer (doesn't need to be null-terminated), the content is fed to the
+ * parser in chunks so the parsing stops soon after it is cancelled.
+ * Note: Do not forgot to execute: cmark_node_free(document); when you are done with the doc.
+ * \param data Pointer to the content
+ * \param length Length of the content in bytes
+ * \param token Cancellation token (eg. of the request)
+ * \return AST structure (of type cmark_node), nullptr when cancelled
+ */
+cmark_node* Parser::parse_content(const char* data, std::size_t length, const CancellationToken& token)
+{
+  cmark_parser* parser = create_parser();
+  cmark_node* document = nullptr;
+  std::size_t offset = 0;
+  while (offset < length && !token.is_cancelled())
+  {
+    std::size_t chunk_length = std::min(ParseChunkSize, length - offset);
+    cmark_parser_feed(parser, data + offset, chunk_length);
+    offset += chunk_length;
+  }
+  // Finishing parses the inline content of the whole document at once, skip it when cancelled
+  if (!token.is_cancelled())
+    document = cmark_parser_finish(parser);
+  cmark_parser_free(parser);
+  return document;
+}
 
+/**
+ * \brief Create a cmark parser with the same options and markdown extensions as parse_content()
+ * Note: Do not forgot to execute: cmark_parser_free(parser); when you are done with the parser.
+ * \return cmark parser
+ */
+cmark_parser* Parser::create_parser()
+{
   cmark_gfm_core_extensions_ensure_registered();
 
-  // Modified version of cmark_parse_document() in blocks.c
   cmark_parser* parser = cmark_parser_new(Options);
-  cmark_node* document;
   // Add extensions
   add_markdown_extension(parser, "strikethrough");
   add_markdown_extension(parser, "highlight");
   add_markdown_extension(parser, "superscript");
   add_markdown_extension(parser, "subscript");
   // add_markdown_extension(parser, "table");
+  return parser;
+}
 
-  cmark_parser_feed(parser, data, strlen(data));
-  document = cmark_parser_finish(parser);
-  cmark_parser_free(parser);
-  return document;
+/**
+ * \brief Link reference definitions (and footnotes) are resolved in the whole document, a cheap check for a possible definition.
+ * \param data Pointer to the content
+ * \param length Length of the content in bytes
+ * \return True when the content might contain a reference definition
+ */
+bool Parser::has_reference_definition(const char* data, std::size_t length)
+{
+  const char* end = data + length;
+  for (const char* pos = data; (pos = static_cast<const char*>(std::memchr(pos, ']', end - pos))) != nullptr; ++pos)
+  {
+    if (pos + 1 < end && pos[1] == ':')
+      return true;
+  }
+  return false;
 }
 
 /**
@@ -75,6 +158,40 @@ Glib::ustring Parser::render_markdown(cmark_node* node)
   return output;
 }
 
+/**
+ * \brief Calculate a fingerprint of the node and all its children, based on everything that is displayed
+ * (node types, text, URLs, heading levels, list properties). Source positions are ignored,
+ * so the same block parsed at another location in the document gives the same fingerprint.
+ * \param node AST node (eg. a top-level block)
+ * \return Fingerprint (hash) value
+ */
+std::uint64_t Parser::get_fingerprint(cmark_node* node)
+{
+  std::uint64_t hash = FnvOffsetBasis;
+  cmark_event_type ev_type;
+  cmark_iter* iter = cmark_iter_new(node);
+  while ((ev_type = cmark_iter_next(iter)) != CMARK_EVENT_DONE)
+  {
+    cmark_node* cur = cmark_iter_get_node(iter);
+    hash_int(hash, ev_type);
+    hash_int(hash, cur->type);
+    if (ev_type != CMARK_EVENT_ENTER)
+      continue;
+    if (cur->extension)
+      hash_string(hash, cur->extension->name);
+    hash_string(hash, cmark_node_get_literal(cur));
+    hash_string(hash, cmark_node_get_url(cur));
+    hash_string(hash, cmark_node_get_title(cur));
+    hash_string(hash, cmark_node_get_fence_info(cur));
+    hash_int(hash, cmark_node_get_heading_level(cur));
+    hash_int(hash, cmark_node_get_list_type(cur));
+    hash_int(hash, cmark_node_get_list_start(cur));
+    hash_int(hash, cmark_node_get_list_tight(cur));
+  }
+  cmark_iter_free(iter);
+  return hash;
+}
+
 /**
  * This is a function that will make enabling extensions easier
  */
@@ -84,3 +201,32 @@ void Parser::add_markdown_extension(cmark_parser* parser, const char* ext_name)
   if (ext)
     cmark_parser_attach_syntax_extension(parser, ext);
 }
+
+/**
+ * Add a (null-terminated) string to the FNV-1a hash, including the terminator
+ */
+void Parser::hash_string(std::uint64_t& hash, const char* str)
+{
+  if (str)
+  {
+    for (; *str != '\0'; ++str)
+    {
+      hash ^= static_cast<unsigned char>(*str);
+      hash *= FnvPrime;
+    }
+  }
+  hash ^= 0xFF;
+  hash *= FnvPrime;
+}
+
+/**
+ * Add an integer value to the FNV-1a hash
+ */
+void Parser::hash_int(std::uint64_t& hash, int value)
+{
+  for (std::size_t i = 0; i < sizeof(value); ++i)
+  {
+    hash ^= (static_cast<unsigned int>(value) >> (i * 8)) & 0xFF;
+    hash *= FnvPrime;
+  }
+}
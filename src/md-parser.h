@@ -1,7 +1,9 @@
 #ifndef MD_PARSER_H
 #define MD_PARSER_H
 
+#include "executor.h"
 #include <cmark-gfm.h>
+#include <cstdint>
 #include <glibmm/ustring.h>
 #include <render.h>
 #include <sstream>
@@ -16,8 +18,14 @@ public:
   // Singleton
   static Parser& get_instance();
   static cmark_node* parse_content(const Glib::ustring& content);
+  static cmark_node* parse_content(const char* data, std::size_t length);
+  static cmark_node* parse_content(const Glib::ustring& content, const CancellationToken& token);
+  static cmark_node* parse_content(const char* data, std::size_t length, const CancellationToken& token);
+  static cmark_parser* create_parser();
+  static bool has_reference_definition(const char* data, std::size_t length);
   static Glib::ustring render_html(cmark_node* node);
   static Glib::ustring render_markdown(cmark_node* node);
+  static std::uint64_t get_fingerprint(cmark_node* node);
 
 private:
   Parser();
@@ -26,5 +34,7 @@ private:
   Parser& operator=(const Parser&) = delete;
 
   static void add_markdown_extension(cmark_parser* parser, const char* ext_name);
+  static void hash_string(std::uint64_t& hash, const char* str);
+  static void hash_int(std::uint64_t& hash, int value);
 };
 #endif
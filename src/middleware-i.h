@@ -1,6 +1,7 @@
 #ifndef MIDDLEWARE_INTERFACE_H
 #define MIDDLEWARE_INTERFACE_H
 
+#include "content-buffer.h"
 #include <glibmm/ustring.h>
 #include <string>
 
@@ -25,8 +26,9 @@ public:
   virtual std::string do_add(const std::string& path) = 0;
   virtual void do_write(const std::string& path, bool isSetAddressAndTitle = true) = 0;
   virtual void set_content(const Glib::ustring& content) = 0;
-  virtual Glib::ustring get_content() const = 0;
+  virtual ContentBuffer get_content() const = 0;
   virtual cmark_node* parse_content() const = 0;
+  virtual void do_preview(const Glib::ustring& content) = 0;
   virtual void reset_content_and_path() = 0;
   virtual std::size_t get_ipfs_number_of_peers() const = 0;
   virtual int get_ipfs_repo_size() const = 0;
@@ -1,45 +1,72 @@
 #include "middleware.h"
 
+#include "content-sniffer.h"
 #include "file.h"
+#include "local-blockstore.h"
 #include "main-window.h"
 #include "md-parser.h"
+#include "render-document.h"
+#include "stream-parser.h"
+#include <algorithm>
 #include <cmark-gfm.h>
+#include <chrono>
 #include <glibmm.h>
 #include <glibmm/main.h>
 
+// Wait until the user stopped typing for this amount of time, before parsing the editor content
+static const std::chrono::milliseconds PreviewDebounceDelay(150);
+// Content of an empty page, shared as well
+static const ContentBuffer EmptyContent = std::make_shared<const std::string>();
+// IPFS status: first update shortly after start-up, then backing off from the minimum to the maximum interval when nothing changes
+static const std::chrono::milliseconds StatusStartDelay(550);
+static const std::chrono::milliseconds StatusMinInterval(4000);
+static const std::chrono::milliseconds StatusMaxInterval(32000);
+// Status interval while the main window is hidden (eg. minimized)
+static const std::chrono::milliseconds StatusHiddenInterval(60000);
+// The repository stats change slowly, only request them every x status updates
+static const unsigned int StatusRepoStatsUpdates = 8;
+// Validate large files in chunks, to check for a cancelled request in between
+static const std::size_t Utf8ValidateChunkSize = 1024 * 1024;
+
+/**
+ * \brief Compare the state of the IPFS node (connection, peers and repository), ignoring the transfer rates.
+ * The rates change on almost every update of a node with any traffic.
+ * \param other Status to compare with
+ * \return true if the state is the same, otherwise false
+ */
+bool IPFSStatus::is_same_state(const IPFSStatus& other) const
+{
+  return number_of_peers == other.number_of_peers && repo_size == other.repo_size && repo_path == other.repo_path &&
+         version == other.version && client_id == other.client_id && client_public_key == other.client_public_key;
+}
+
 /**
  * Middleware constructor
  */
-Middleware::Middleware(MainWindow& main_window, const std::string& timeout)
+Middleware::Middleware(MainWindow& main_window, const ApiAddress& api_address, const std::string& timeout)
     : main_window_(main_window),
       // Threading:
-      request_thread_(nullptr),
-      status_thread_(nullptr),
-      is_request_thread_done_(false),
-      keep_request_thread_running_(true),
-      is_status_thread_done_(false),
+      request_generation_(0),
+      preview_generation_(0),
+      is_preview_pending_(false),
+      is_preview_reset_(false),
       // IPFS:
-      ipfs_host_("localhost"),
-      ipfs_port_(5001),
+      ipfs_api_(api_address),
       ipfs_timeout_(timeout),
-      ipfs_fetch_(ipfs_host_, ipfs_port_, ipfs_timeout_),
-      ipfs_status_(ipfs_host_, ipfs_port_, ipfs_timeout_),
-      ipfs_number_of_peers_(0),
-      ipfs_repo_size_(0),
-      ipfs_incoming_rate_("0.0"),
-      ipfs_outgoing_rate_("0.0"),
+      ipfs_pool_(ipfs_api_, ipfs_timeout_),
+      ipfs_status_snapshot_(std::make_shared<const IPFSStatus>()),
+      is_status_visible_(true),
+      disk_cache_(Glib::build_filename(Glib::get_user_cache_dir(), "libreweb", "documents")),
       // Request & Response:
+      current_content_(EmptyContent),
       wait_page_visible_(false)
 {
   // Hook up signals to Main Window methods
   request_started_.connect(sigc::mem_fun(main_window, &MainWindow::started_request));
   request_finished_.connect(sigc::mem_fun(main_window, &MainWindow::finished_request));
 
-  // First update status manually (with slight delay), after that the timer below will take care of updates
-  Glib::signal_timeout().connect_once(sigc::mem_fun(this, &Middleware::do_ipfs_status_update_once), 550);
-
-  // Create a timer, triggers every 4 seconds
-  status_timer_handler_ = Glib::signal_timeout().connect_seconds(sigc::mem_fun(this, &Middleware::do_ipfs_status_update), 4);
+  // Keep the IPFS status up-to-date on the (long-lived) status worker
+  status_token_ = executor_.post(Executor::LANE_STATUS, [this](const CancellationToken& token) { monitor_ipfs_status(token); });
 }
 
 /**
@@ -47,13 +74,16 @@ Middleware::Middleware(MainWindow& main_window, const std::string& timeout)
  */
 Middleware::~Middleware()
 {
-  status_timer_handler_.disconnect();
   abort_request();
   abort_status();
+  // Wake-up a waiting preview task
+  discard_preview();
+  preview_condition_.notify_all();
+  executor_.stop();
 }
 
 /**
- * Fetch document from disk or IPFS, using threading
+ * Fetch document from disk or IPFS, on the navigation worker
  * \param path File path that needs to be opened (either from disk or IPFS network)
  * \param is_set_address_bar If true update the address bar with the file path (default: true)
  * \param is_history_request Set to true if this is an history request call: back/forward (default: false)
@@ -66,27 +96,53 @@ void Middleware::do_request(const std::string& path, bool is_set_address_bar, bo
   // Stop any on-going request first, if applicable
   abort_request();
 
-  if (request_thread_ == nullptr)
+  std::string title;
+  if (path.empty() && request_path_.starts_with("file://"))
   {
-    std::string title;
-    if (path.empty() && request_path_.starts_with("file://"))
-    {
-      title = File::get_filename(request_path_); // During refresh
-    }
-    else if (path.starts_with("file://"))
-    {
-      title = File::get_filename(path);
-    }
-    // Update main window widgets
-    main_window_.pre_request(path, title, is_set_address_bar, is_history_request, is_disable_editor);
-
-    // Start thread
-    request_thread_ = new std::thread(&Middleware::process_request, this, path, is_parse_content);
+    title = File::get_filename(request_path_); // During refresh
   }
-  else
+  else if (path.starts_with("file://"))
   {
-    std::cerr << "ERROR: Could not start request thread. Something went wrong." << std::endl;
+    title = File::get_filename(path);
   }
+  // Update main window widgets
+  main_window_.pre_request(path, title, is_set_address_bar, is_history_request, is_disable_editor);
+
+  // Do not update the request_path_ when path is empty,
+  // this is used for refreshing the page
+  if (!path.empty())
+    request_path_ = path;
+  // Reset private variables, the content is set again when the request is finished
+  current_content_ = EmptyContent;
+  wait_page_visible_ = false;
+
+  // Queue the request on the (long-lived) navigation worker
+  std::size_t generation = request_generation_;
+  std::string request_path = request_path_;
+  executor_.post(Executor::LANE_NAVIGATION,
+                 [this, request_path, generation, is_parse_content](const CancellationToken& token)
+                 { process_request(request_path, generation, is_parse_content, token); });
+}
+
+/**
+ * \brief Show a page from the history again without a new request, the main window displays the stored document.
+ * \param path File path (on disk or IPFS) of the history entry
+ * \param content Content of the history entry (not parsed)
+ */
+void Middleware::restore_request(const std::string& path, ContentBuffer content)
+{
+  // Stop any on-going request first, its results are dropped so it doesn't overwrite the restored page
+  abort_request();
+  // The spinning icon is not stopped by the cancelled request
+  main_window_.finished_request();
+
+  std::string title;
+  if (path.starts_with("file://"))
+    title = File::get_filename(path);
+  main_window_.pre_request(path, title, true, true, true);
+  request_path_ = path;
+  current_content_ = std::move(content);
+  wait_page_visible_ = false;
 }
 
 /**
@@ -97,8 +153,8 @@ void Middleware::do_request(const std::string& path, bool is_set_address_bar, bo
 std::string Middleware::do_add(const std::string& path)
 {
   // TODO: We should run this within a separate thread, to avoid blocking the main thread.
-  // See also the other status calls we are making, but maybe we should use ipfs_fetch_ anyway.
-  return ipfs_status_.add(path, get_content());
+  // Uses its own connection of the pool, so it doesn't wait for (or conflict with) the on-going request or status update
+  return ipfs_pool_.acquire()->add(path, *get_content());
 }
 
 /**
@@ -108,23 +164,44 @@ std::string Middleware::do_add(const std::string& path)
  */
 void Middleware::do_write(const std::string& path, bool is_set_address_and_title)
 {
-  File::write(path, get_content());
+  File::write(path, *get_content());
   main_window_.post_write("file://" + path, File::get_filename(path), is_set_address_and_title);
 }
 
 /**
- * \brief Set current plain-text content (not parsed)
+ * \brief Set current plain-text content (not parsed), eg. the content of the editor
  */
 void Middleware::set_content(const Glib::ustring& content)
 {
-  current_content_ = content;
+  current_content_ = std::make_shared<const std::string>(content.raw());
+}
+
+/**
+ * \brief Set the content of a request (on the GUI thread), unless a newer request is started in the meantime
+ * \param content Plain-text content (not parsed)
+ * \param generation Generation number of the request
+ */
+void Middleware::set_request_content(ContentBuffer content, std::size_t generation)
+{
+  if (is_request_current(generation))
+    current_content_ = std::move(content);
+}
+
+/**
+ * \brief Check if the request result is still the newest one
+ * \param generation Generation number of the request result
+ * \return true if no other request is started (or aborted) since, otherwise false (stale result)
+ */
+bool Middleware::is_request_current(std::size_t generation) const
+{
+  return generation == request_generation_;
 }
 
 /**
- * \brief Get current plain content (not parsed)
- * \return content as string
+ * \brief Get current plain content (not parsed), the content is shared (not copied)
+ * \return content buffer, never nullptr
  */
-Glib::ustring Middleware::get_content() const
+ContentBuffer Middleware::get_content() const
 {
   return current_content_;
 }
@@ -136,7 +213,67 @@ Glib::ustring Middleware::get_content() const
  */
 cmark_node* Middleware::parse_content() const
 {
-  return Parser::parse_content(current_content_);
+  return Parser::parse_content(current_content_->data(), current_content_->size());
+}
+
+/**
+ * \brief Queue a snapshot of the editor content for the live preview.
+ * Only the snapshot is stored (and set as current content), the parsing is done by a preview task
+ * once the user stopped typing. Older snapshots that are not yet parsed are replaced by the newest one.
+ * \param content Current plain-text content of the editor
+ */
+void Middleware::do_preview(const Glib::ustring& content)
+{
+  set_content(content);
+  {
+    std::lock_guard<std::mutex> guard(preview_mutex_);
+    preview_content_ = current_content_;
+    is_preview_pending_ = true;
+    preview_generation_++;
+  }
+  // Wake-up the preview task that is waiting for the user to stop typing, the newer snapshot is handled instead
+  preview_condition_.notify_all();
+  executor_.post(Executor::LANE_PARSE, [this](const CancellationToken& token) { process_preview(token); });
+}
+
+/**
+ * \brief Check if the preview result is still the newest one
+ * \param generation Generation number of the preview result
+ * \return true if no newer editor snapshot is queued since, otherwise false (stale result)
+ */
+bool Middleware::is_preview_current(std::size_t generation) const
+{
+  return generation == preview_generation_;
+}
+
+/**
+ * \brief Discard the pending editor snapshot as well as any in-flight preview result (eg. when leaving the editor)
+ */
+void Middleware::discard_preview()
+{
+  std::lock_guard<std::mutex> guard(preview_mutex_);
+  preview_content_.reset();
+  is_preview_pending_ = false;
+  is_preview_reset_ = true;
+  preview_generation_++;
+}
+
+/**
+ * \brief Set the memory limit of the IPFS document cache
+ * \param max_bytes Memory limit in bytes
+ */
+void Middleware::set_document_cache_limit(std::size_t max_bytes)
+{
+  document_cache_.set_max_bytes(max_bytes);
+}
+
+/**
+ * \brief Set the disk space limit of the persistent IPFS document cache
+ * \param max_bytes Disk space limit in bytes
+ */
+void Middleware::set_disk_cache_limit(std::size_t max_bytes)
+{
+  disk_cache_.set_max_bytes(max_bytes);
 }
 
 /**
@@ -144,9 +281,8 @@ cmark_node* Middleware::parse_content() const
  */
 void Middleware::reset_content_and_path()
 {
-  current_content_ = "";
+  current_content_ = EmptyContent;
   request_path_ = "";
-  final_request_path_ = "";
 }
 
 /**
@@ -155,7 +291,7 @@ void Middleware::reset_content_and_path()
  */
 std::size_t Middleware::get_ipfs_number_of_peers() const
 {
-  return ipfs_number_of_peers_;
+  return get_ipfs_status()->number_of_peers;
 }
 
 /**
@@ -164,7 +300,7 @@ std::size_t Middleware::get_ipfs_number_of_peers() const
  */
 int Middleware::get_ipfs_repo_size() const
 {
-  return ipfs_repo_size_;
+  return get_ipfs_status()->repo_size;
 }
 
 /**
@@ -173,7 +309,7 @@ int Middleware::get_ipfs_repo_size() const
  */
 std::string Middleware::get_ipfs_repo_path() const
 {
-  return ipfs_repo_path_;
+  return get_ipfs_status()->repo_path;
 }
 
 /**
@@ -182,7 +318,7 @@ std::string Middleware::get_ipfs_repo_path() const
  */
 std::string Middleware::get_ipfs_incoming_rate() const
 {
-  return ipfs_incoming_rate_;
+  return get_ipfs_status()->incoming_rate;
 }
 
 /**
@@ -191,7 +327,7 @@ std::string Middleware::get_ipfs_incoming_rate() const
  */
 std::string Middleware::get_ipfs_outgoing_rate() const
 {
-  return ipfs_outgoing_rate_;
+  return get_ipfs_status()->outgoing_rate;
 }
 
 /**
@@ -200,7 +336,7 @@ std::string Middleware::get_ipfs_outgoing_rate() const
  */
 std::string Middleware::get_ipfs_version() const
 {
-  return ipfs_version_;
+  return get_ipfs_status()->version;
 }
 
 /**
@@ -209,7 +345,7 @@ std::string Middleware::get_ipfs_version() const
  */
 std::string Middleware::get_ipfs_client_id() const
 {
-  return ipfs_client_id_;
+  return get_ipfs_status()->client_id;
 }
 
 /**
@@ -218,7 +354,31 @@ std::string Middleware::get_ipfs_client_id() const
  */
 std::string Middleware::get_ipfs_client_public_key() const
 {
-  return ipfs_client_public_key_;
+  return get_ipfs_status()->client_public_key;
+}
+
+/**
+ * \brief Get the IPFS status, all values of a snapshot are from the same status update
+ * \return Status snapshot (immutable)
+ */
+std::shared_ptr<const IPFSStatus> Middleware::get_ipfs_status() const
+{
+  std::lock_guard<std::mutex> guard(status_mutex_);
+  return ipfs_status_snapshot_;
+}
+
+/**
+ * \brief Set if the main window is visible, the IPFS status is updated less often while hidden
+ * \param is_visible Is the main window visible (eg. not minimized)
+ */
+void Middleware::set_status_visible(bool is_visible)
+{
+  {
+    std::lock_guard<std::mutex> guard(status_mutex_);
+    is_status_visible_ = is_visible;
+  }
+  // Update the status directly when the window is visible again
+  status_condition_.notify_all();
 }
 
 /************************************************
@@ -228,111 +388,197 @@ std::string Middleware::get_ipfs_client_public_key() const
 /**
  * \brief Get the file from disk or IPFS network, from the provided path,
  * parse the content, and display the document.
- * Call this method with empty path, will use the previous request_path_ (thus refresh).
  * \param path File path that needs to be fetched (from disk or IPFS network)
+ * \param generation Generation number of the request, the main window drops the results of older requests
  * \param isParseContent Set to true if you want to parse and display the content as markdown syntax (from disk or IPFS
  * network), set to false if you want to edit the content
+ * \param token Cancellation token of the request
  */
-void Middleware::process_request(const std::string& path, bool isParseContent)
+void Middleware::process_request(const std::string& path, std::size_t generation, bool isParseContent, const CancellationToken& token)
 {
   request_started_.emit(); // Emit started for Main Window
-  // Reset private variables
-  current_content_ = "";
-  wait_page_visible_ = false;
 
-  // Do not update the request_path_ when path is empty,
-  // this is used for refreshing the page
-  if (!path.empty())
-  {
-    request_path_ = path;
-  }
-
-  if (request_path_.empty())
+  if (path.empty())
   {
     std::cerr << "Info: Empty request path." << std::endl;
   }
   // Handle homepage
-  else if (request_path_.compare("about:home") == 0)
+  else if (path.compare("about:home") == 0)
   {
-    Glib::signal_idle().connect_once(sigc::mem_fun(main_window_, &MainWindow::show_homepage));
+    Glib::signal_idle().connect_once(sigc::bind(sigc::mem_fun(main_window_, &MainWindow::show_homepage), generation));
   }
   // Handle disk or IPFS file paths
   else
   {
     // Check if CID
-    if (request_path_.starts_with("ipfs://"))
+    if (path.starts_with("ipfs://"))
     {
-      final_request_path_ = request_path_;
+      final_request_path_ = path;
       final_request_path_.erase(0, 7);
-      fetch_from_ipfs(isParseContent);
+      fetch_from_ipfs(generation, isParseContent, token);
     }
-    else if ((request_path_.length() == 46) && request_path_.starts_with("Qm"))
+    else if ((path.length() == 46) && path.starts_with("Qm"))
     {
       // CIDv0
-      final_request_path_ = request_path_;
-      fetch_from_ipfs(isParseContent);
+      final_request_path_ = path;
+      fetch_from_ipfs(generation, isParseContent, token);
     }
-    else if (request_path_.starts_with("file://"))
+    else if (path.starts_with("file://"))
     {
-      final_request_path_ = request_path_;
+      final_request_path_ = path;
       final_request_path_.erase(0, 7);
-      open_from_disk(isParseContent);
+      open_from_disk(generation, isParseContent, token);
     }
     else
     {
       // IPFS as fallback / CIDv1
-      final_request_path_ = request_path_;
-      fetch_from_ipfs(isParseContent);
+      final_request_path_ = path;
+      fetch_from_ipfs(generation, isParseContent, token);
     }
   }
+  // Return the connection of the request to the pool
+  {
+    std::lock_guard<std::mutex> guard(connection_mutex_);
+    request_connection_.reset();
+  }
 
-  request_finished_.emit();       // Emit finished for Main Window
-  is_request_thread_done_ = true; // mark thread as done
+  request_finished_.emit(); // Emit finished for Main Window
 }
 
 /**
  * \brief Helper method for process_request(), display markdown file from IPFS network.
- * Runs in a separate thread.
+ * Runs on the navigation worker.
+ * \param generation Generation number of the request
  * \param isParseContent Set to true if you want to parse and display the content as markdown syntax (from disk or IPFS
  * network), set to false if you want to edit the content
+ * \param token Cancellation token of the request
  */
-void Middleware::fetch_from_ipfs(bool isParseContent)
+void Middleware::fetch_from_ipfs(std::size_t generation, bool isParseContent, const CancellationToken& token)
 {
+  // IPFS content is immutable, so content that is fetched before doesn't need to be fetched (and parsed) again
+  std::string cache_key = DocumentCache::get_key(final_request_path_);
+  CachedDocument cached;
+  if (!cache_key.empty() && document_cache_.get(cache_key, cached))
+  {
+    open_from_cache(cache_key, cached, generation, isParseContent, token);
+    return;
+  }
+  // Visited before, also before the browser was started
+  if (!cache_key.empty() && disk_cache_.load(cache_key, cached))
+  {
+    document_cache_.put(cache_key, cached.content, cached.document);
+    open_from_cache(cache_key, cached, generation, isParseContent, token);
+    return;
+  }
+  ContentSniffer sniffer;
   try
   {
-    std::stringstream contents;
-    ipfs_fetch_.fetch(final_request_path_, &contents);
-    // If the thread stops, don't brother to parse the file/update the GTK window
-    if (keep_request_thread_running_)
+    std::string contents;
+    StreamParser stream_parser;
+    bool is_document_started = false;
+    auto process_chunk = [&](const char* data, std::size_t length)
+    {
+      // Stop reading as soon as the content turns out not to be text (eg. a video or an archive)
+      if (!sniffer.feed(data, length) || token.is_cancelled())
+        return false;
+      if (!isParseContent)
+      {
+        contents.append(data, length);
+        return true;
+      }
+      // Already display the blocks that are finished, while the rest of the document is still downloading
+      cmark_node* doc = stream_parser.feed(data, length);
+      if (doc != nullptr)
+      {
+        Glib::signal_idle().connect_once(sigc::bind(sigc::mem_fun(main_window_, &MainWindow::append_document), compile_document(doc),
+                                                    !is_document_started, false, generation));
+        is_document_started = true;
+      }
+      return true;
+    };
+    // Content in the local repository is read directly from disk, otherwise (a miss) it's fetched via the IPFS API
+    std::size_t skip_length = 0;
+    if (!read_from_local_repo(process_chunk, token, skip_length))
+    {
+      // Lease a connection for the download, abort_request() aborts it from the GUI thread
+      IPFSPool::Connection ipfs = ipfs_pool_.acquire();
+      {
+        std::lock_guard<std::mutex> guard(connection_mutex_);
+        request_connection_ = ipfs;
+      }
+      // The request could be aborted before the connection was known
+      if (!token.is_cancelled())
+      {
+        ipfs->fetch(final_request_path_,
+                    [&](const char* data, std::size_t length)
+                    {
+                      // Skip the start of the content that is already read from the local repository
+                      std::size_t skipped = std::min(skip_length, length);
+                      skip_length -= skipped;
+                      if (length > skipped && !process_chunk(data + skipped, length - skipped))
+                        ipfs->abort();
+                    });
+      }
+    }
+    // If the request is cancelled, don't brother to parse the file/update the GTK window
+    if (!token.is_cancelled())
     {
-      // Retrieve content to string
-      Glib::ustring content = contents.str();
-      // Only set content if valid UTF-8
-      if (Middleware::validate_utf8(content) && keep_request_thread_running_)
+      // Only set content if valid UTF-8, the content is already validated while receiving
+      if (sniffer.finish())
       {
-        set_content(content);
+        cmark_node* doc = (isParseContent && is_document_started) ? stream_parser.finish() : nullptr;
+        // Move the received content into a shared buffer, this is the only copy of the content from now on
+        ContentBuffer content = std::make_shared<const std::string>(isParseContent ? stream_parser.release_content() : std::move(contents));
+        post_content(content, generation);
+        CachedDocument fetched = {content, nullptr};
         if (isParseContent)
         {
-          // TODO: Maybe we want to abort the parser when keep_request_thread_running_ = false,
-          // depending time the parser is taking?
-          cmark_node* doc = parse_content();
-          Glib::signal_idle().connect_once(sigc::bind(sigc::mem_fun(main_window_, &MainWindow::set_document), doc));
+          if (doc != nullptr)
+          {
+            // Append the last blocks
+            Glib::signal_idle().connect_once(
+                sigc::bind(sigc::mem_fun(main_window_, &MainWindow::append_document), compile_document(doc), false, true, generation));
+          }
+          else if (is_document_started)
+          {
+            // Streaming was stopped, only the blocks that are not displayed yet will be drawn
+            fetched.document = parse_document(content, token);
+            if (fetched.document)
+              Glib::signal_idle().connect_once(
+                  sigc::bind(sigc::mem_fun(main_window_, &MainWindow::finish_document), fetched.document, generation));
+          }
+          else
+          {
+            fetched.document = parse_document(content, token);
+            if (fetched.document)
+              Glib::signal_idle().connect_once(
+                  sigc::bind(sigc::mem_fun(main_window_, &MainWindow::set_document), fetched.document, generation));
+          }
         }
         else
         {
           // Directly display the plain markdown content
-          Glib::signal_idle().connect_once(sigc::bind(sigc::mem_fun(main_window_, &MainWindow::set_text), get_content()));
+          Glib::signal_idle().connect_once(sigc::bind(sigc::mem_fun(main_window_, &MainWindow::set_text), content, generation));
         }
+        // Streamed documents are only cached as content, the document is compiled when it's opened again
+        document_cache_.put(cache_key, fetched.content, fetched.document);
+        store_in_disk_cache(cache_key, fetched);
       }
       else
       {
-        Glib::signal_idle().connect_once(sigc::bind(sigc::mem_fun(main_window_, &MainWindow::set_message), "😵 File will not be displayed ",
-                                                    "File is not valid UTF-8 encoded, like a markdown or text file."));
+        post_not_text_message(sniffer, generation);
       }
     }
   }
   catch (const std::runtime_error& error)
   {
+    // The download is stopped, because the content is not text
+    if (!sniffer.is_text())
+    {
+      if (!token.is_cancelled())
+        post_not_text_message(sniffer, generation);
+      return;
+    }
     std::string errorMessage = std::string(error.what());
     // Ignore error reporting when the request was aborted
     if (errorMessage != "Request was aborted")
@@ -362,144 +608,284 @@ void Middleware::fetch_from_ipfs(bool isParseContent)
         }
         Glib::signal_idle().connect_once(sigc::bind(sigc::mem_fun(main_window_, &MainWindow::set_message),
                                                     "🎂 We're having trouble finding this site.",
-                                                    message + "You could try to reload the page or try increase the time-out (see --help)."));
+                                                    message + "You could try to reload the page or try increase the time-out (see --help).",
+                                                    generation));
       }
-      else if (errorMessage.starts_with("Couldn't connect to server: Failed to connect to localhost"))
+      else if (errorMessage.starts_with("Couldn't connect to server"))
       {
         Glib::signal_idle().connect_once(sigc::bind(sigc::mem_fun(main_window_, &MainWindow::set_message), "⌛ Please wait...",
-                                                    "IPFS daemon is still spinnng-up, page will automatically refresh..."));
-        wait_page_visible_ = true; // Please wait page is shown (auto-refresh when network is up)
+                                                    "IPFS daemon is still spinnng-up, page will automatically refresh...", generation));
+        // Please wait page is shown (auto-refresh when network is up)
+        if (is_request_current(generation))
+          wait_page_visible_ = true;
       }
       else
       {
         Glib::signal_idle().connect_once(sigc::bind(sigc::mem_fun(main_window_, &MainWindow::set_message), "❌ Something went wrong",
-                                                    "Error message: " + std::string(error.what())));
+                                                    "Error message: " + std::string(error.what()), generation));
       }
     }
   }
 }
 
+/**
+ * \brief Helper method for fetch_from_ipfs(), read the file directly from the local IPFS repository (bypassing the IPFS API).
+ * Only used when the IPFS daemon runs on this machine, and the repository path is known (see the IPFS status).
+ * \param chunk_callback Called for each chunk of the file content, return false to stop reading
+ * \param token Cancellation token of the request
+ * \param read_length Length of the content that is already passed on, when the file is not completely in the local repository
+ * \return true if read from the local repository, false when the file is not (completely) in the local repository (a miss)
+ */
+bool Middleware::read_from_local_repo(const std::function<bool(const char* data, std::size_t length)>& chunk_callback,
+                                      const CancellationToken& token,
+                                      std::size_t& read_length)
+{
+  read_length = 0;
+  if (!ipfs_api_.is_local())
+    return false;
+  std::string repo_path = get_ipfs_status()->repo_path;
+  if (repo_path.empty())
+    return false;
+  LocalBlockstore blockstore(repo_path);
+  return blockstore.read_file(final_request_path_, chunk_callback, token, read_length);
+}
+
+/**
+ * \brief Helper method for fetch_from_ipfs(), display content from the document cache.
+ * The content is only parsed when the compiled document is not cached yet.
+ * Runs on the navigation worker.
+ * \param cache_key Cache key of the content
+ * \param cached Cached content
+ * \param generation Generation number of the request
+ * \param isParseContent Set to true if you want to parse and display the content as markdown syntax,
+ * set to false if you want to edit the content
+ * \param token Cancellation token of the request
+ */
+void Middleware::open_from_cache(
+    const std::string& cache_key, const CachedDocument& cached, std::size_t generation, bool isParseContent, const CancellationToken& token)
+{
+  post_content(cached.content, generation);
+  if (isParseContent)
+  {
+    std::shared_ptr<const RenderDocument> document = cached.document;
+    bool is_compiled = !document;
+    if (is_compiled)
+      document = parse_document(cached.content, token);
+    if (!document)
+      return; // Cancelled while parsing
+    if (!token.is_cancelled())
+      Glib::signal_idle().connect_once(sigc::bind(sigc::mem_fun(main_window_, &MainWindow::set_document), document, generation));
+    if (is_compiled)
+    {
+      // Cache the compiled document as well
+      document_cache_.set_document(cache_key, document);
+      store_in_disk_cache(cache_key, {cached.content, document});
+    }
+  }
+  else if (!token.is_cancelled())
+  {
+    // Directly display the plain markdown content
+    Glib::signal_idle().connect_once(sigc::bind(sigc::mem_fun(main_window_, &MainWindow::set_text), cached.content, generation));
+  }
+}
+
 /**
  * \brief Helper method for process_request(), display markdown file from disk.
- * Runs in a separate thread.
+ * Runs on the navigation worker.
+ * \param generation Generation number of the request
  * \param isParseContent Set to true if you want to parse and display the content as markdown syntax (from disk or IPFS
  * network), set to false if you want to edit the content
+ * \param token Cancellation token of the request
  */
-void Middleware::open_from_disk(bool isParseContent)
+void Middleware::open_from_disk(std::size_t generation, bool isParseContent, const CancellationToken& token)
 {
   try
   {
-    // TODO: Abort file read if keep_request_thread_running_ = false and throw runtime error, to stop further execution
-    // eg. when you are reading a very big file from disk.
-    const Glib::ustring content = File::read(final_request_path_);
-    // If the thread stops, don't brother to parse the file/update the GTK window
-    if (keep_request_thread_running_)
+    // The file is mapped instead of read into memory, the pages are read from disk while validating/parsing
+    std::unique_ptr<MappedFile> file = File::map(final_request_path_);
+    // Only set content if valid UTF-8, stops early when the request is cancelled (or the content is not text)
+    ContentSniffer sniffer;
+    bool is_valid = Middleware::validate_utf8(sniffer, file->data(), file->size(), token);
+    // If the request is cancelled, don't brother to parse the file/update the GTK window
+    if (token.is_cancelled())
+      return;
+    if (is_valid)
     {
-      // Only set content if valid UTF-8
-      if (Middleware::validate_utf8(content))
+      // The content buffer is the only copy of the file in memory, made once. The buffer can't refer to the mapping: a local file can
+      // be changed or truncated on disk, while the buffer is still used (eg. by the editor or the history).
+      if (isParseContent)
       {
-        set_content(content);
-        if (isParseContent)
-        {
-          cmark_node* doc = parse_content();
-          Glib::signal_idle().connect_once(sigc::bind(sigc::mem_fun(main_window_, &MainWindow::set_document), doc));
-        }
-        else
+        // Parse directly from the mapped file, nothing to display when the request is cancelled while parsing
+        std::shared_ptr<const RenderDocument> document = parse_document(file->data(), file->size(), token);
+        if (document)
         {
-          // Directly set the plain markdown content
-          Glib::signal_idle().connect_once(sigc::bind(sigc::mem_fun(main_window_, &MainWindow::set_text), get_content()));
+          post_content(std::make_shared<const std::string>(file->data(), file->size()), generation);
+          Glib::signal_idle().connect_once(sigc::bind(sigc::mem_fun(main_window_, &MainWindow::set_document), document, generation));
         }
       }
       else
       {
-        Glib::signal_idle().connect_once(sigc::bind(sigc::mem_fun(main_window_, &MainWindow::set_message), "😵 File will not be displayed ",
-                                                    "File is not valid UTF-8 encoded, like a markdown file or text file."));
+        // Directly set the plain markdown content
+        ContentBuffer content = std::make_shared<const std::string>(file->data(), file->size());
+        post_content(content, generation);
+        Glib::signal_idle().connect_once(sigc::bind(sigc::mem_fun(main_window_, &MainWindow::set_text), content, generation));
       }
     }
+    else
+    {
+      post_not_text_message(sniffer, generation);
+    }
   }
   catch (const std::ios_base::failure& error)
   {
     std::cerr << "ERROR: Could not read file: " << final_request_path_ << ". Message: " << error.what() << ".\nError code: " << error.code()
               << std::endl;
-    Glib::signal_idle().connect_once(
-        sigc::bind(sigc::mem_fun(main_window_, &MainWindow::set_message), "🎂 Could not read file", "Message: " + std::string(error.what())));
+    Glib::signal_idle().connect_once(sigc::bind(
+        sigc::mem_fun(main_window_, &MainWindow::set_message), "🎂 Could not read file", "Message: " + std::string(error.what()), generation));
   }
   catch (const std::runtime_error& error)
   {
     std::cerr << "ERROR: File request failed, file: " << final_request_path_ << ". Message: " << error.what() << std::endl;
-    Glib::signal_idle().connect_once(
-        sigc::bind(sigc::mem_fun(main_window_, &MainWindow::set_message), "🎂 File not found", "Message: " + std::string(error.what())));
+    Glib::signal_idle().connect_once(sigc::bind(
+        sigc::mem_fun(main_window_, &MainWindow::set_message), "🎂 File not found", "Message: " + std::string(error.what()), generation));
   }
 }
 
 /**
- * \brief Simple wrapper of the method below with void return
+ * \brief Editor live preview task, queued for every editor content snapshot (see do_preview()).
+ * A snapshot is only parsed after the debounce delay, without any newer snapshot arriving in the meantime.
+ * Only the blocks touched by the edit are parsed again (see IncrementalParser), the resulting document is compiled
+ * for drawing (see RenderDocument) before it is passed to the main window.
+ * Runs on the parse worker, so the preview parser is only used by one thread.
+ * \param token Cancellation token of the task
  */
-void Middleware::do_ipfs_status_update_once()
+void Middleware::process_preview(const CancellationToken& token)
 {
-  do_ipfs_status_update();
+  std::unique_lock<std::mutex> lock(preview_mutex_);
+  // Nothing to do when the snapshot is already parsed by an earlier task, or discarded
+  if (!is_preview_pending_ || token.is_cancelled())
+    return;
+  // Debounce: a newer snapshot arriving within the delay is handled by its own task
+  std::size_t generation = preview_generation_;
+  if (preview_condition_.wait_for(
+          lock, PreviewDebounceDelay, [this, generation, &token] { return token.is_cancelled() || preview_generation_ != generation; }))
+    return;
+
+  ContentBuffer content = std::move(preview_content_);
+  bool is_reset = is_preview_reset_;
+  is_preview_pending_ = false;
+  is_preview_reset_ = false;
+  lock.unlock();
+  if (is_reset)
+    preview_parser_.reset();
+  std::shared_ptr<const RenderDocument> document = RenderDocument::compile(preview_parser_.update(*content));
+  // Skip stale result, a newer snapshot is already waiting
+  if (!token.is_cancelled() && is_preview_current(generation))
+  {
+    Glib::signal_idle().connect_once(sigc::bind(sigc::mem_fun(main_window_, &MainWindow::set_preview_document), document, generation));
+  }
 }
 
 /**
- * \brief Timeout slot: Update the IPFS connection status every x seconds.
- * Process requests inside a separate thread, to avoid blocking the GUI thread.
- * \return always true, when running as a GTK timeout handler
+ * \brief IPFS status monitor, keeps the status up-to-date until it is cancelled.
+ * The status is requested less often when nothing changes, or when the main window is hidden.
+ * Runs on the status worker for the lifetime of the middleware.
+ * \param token Cancellation token of the monitor
  */
-bool Middleware::do_ipfs_status_update()
+void Middleware::monitor_ipfs_status(const CancellationToken& token)
 {
-  // Stop any on-going status calls first, if applicable
-  abort_status();
-
-  if (status_thread_ == nullptr)
+  IPFSStatus status;
+  std::chrono::milliseconds interval = StatusStartDelay;
+  unsigned int update_count = 0;
+  while (wait_status_interval(interval, token))
   {
-    status_thread_ = new std::thread(&Middleware::process_ipfs_status, this);
+    // Lease a connection for this update only, between the updates the (idle) connection can be used by others
+    IPFSPool::Connection ipfs = ipfs_pool_.acquire();
+    {
+      std::lock_guard<std::mutex> guard(connection_mutex_);
+      status_connection_ = ipfs;
+    }
+    if (token.is_cancelled())
+      break;
+    IPFSStatus previous_status = status;
+    fetch_ipfs_status(*ipfs, status, update_count++ % StatusRepoStatsUpdates == 0);
+    {
+      std::lock_guard<std::mutex> guard(connection_mutex_);
+      status_connection_.reset();
+    }
+    publish_ipfs_status(status);
+    // Changed transfer rates are shown, but only a changed state of the node resets the interval
+    bool is_state_changed = !status.is_same_state(previous_status);
+    if (!is_status_visible_)
+      interval = StatusHiddenInterval;
+    // Keep checking often while the 'Please wait' page is shown, the page is refreshed when connected
+    else if (is_state_changed || wait_page_visible_)
+      interval = StatusMinInterval;
+    else
+      interval = std::min(interval * 2, StatusMaxInterval);
   }
-  // Keep going (never disconnect the timer)
-  return true;
 }
 
 /**
- * Process the IPFS status calls.
- * Runs inside a thread.
+ * \brief Wait for the next status update
+ * \param interval Time until the next status update
+ * \param token Cancellation token of the monitor
+ * \return false when the monitor is cancelled, otherwise true
  */
-void Middleware::process_ipfs_status()
+bool Middleware::wait_status_interval(std::chrono::milliseconds interval, const CancellationToken& token)
+{
+  std::unique_lock<std::mutex> lock(status_mutex_);
+  bool was_visible = is_status_visible_;
+  status_condition_.wait_for(lock, interval, [this, &token, was_visible] { return token.is_cancelled() || (!was_visible && is_status_visible_); });
+  return !token.is_cancelled();
+}
+
+/**
+ * \brief Request the IPFS status, the values that don't change (like the version) are only requested once.
+ * Runs on the status worker.
+ * \param ipfs Connection leased for the status update
+ * \param status Status that is updated
+ * \param is_fetch_repo_stats Request the repository stats as well (they are always requested after (re)connecting)
+ */
+void Middleware::fetch_ipfs_status(IPFS& ipfs, IPFSStatus& status, bool is_fetch_repo_stats)
 {
-  std::lock_guard<std::mutex> guard(status_mutex_);
   try
   {
-    ipfs_number_of_peers_ = ipfs_status_.get_nr_peers();
-    if (ipfs_number_of_peers_ > 0)
+    status.number_of_peers = ipfs.get_nr_peers();
+    if (status.number_of_peers > 0)
     {
       // Auto-refresh page if needed (when 'Please wait' page was shown)
       if (wait_page_visible_)
         Glib::signal_idle().connect_once(sigc::mem_fun(main_window_, &MainWindow::refresh_request));
 
-      std::map<std::string, std::variant<int, std::string>> repoStats = ipfs_status_.get_repo_stats();
-      ipfs_repo_size_ = std::get<int>(repoStats.at("repo-size"));
-      ipfs_repo_path_ = std::get<std::string>(repoStats.at("path"));
+      if (is_fetch_repo_stats || status.repo_path.empty())
+      {
+        std::map<std::string, std::variant<int, std::string>> repoStats = ipfs.get_repo_stats();
+        status.repo_size = std::get<int>(repoStats.at("repo-size"));
+        status.repo_path = std::get<std::string>(repoStats.at("path"));
+      }
 
-      std::map<std::string, float> rates = ipfs_status_.get_bandwidth_rates();
+      std::map<std::string, float> rates = ipfs.get_bandwidth_rates();
       char buf[32];
-      ipfs_incoming_rate_ = std::string(buf, std::snprintf(buf, sizeof buf, "%.1f", rates.at("in") / 1000.0));
-      ipfs_outgoing_rate_ = std::string(buf, std::snprintf(buf, sizeof buf, "%.1f", rates.at("out") / 1000.0));
+      status.incoming_rate = std::string(buf, std::snprintf(buf, sizeof buf, "%.1f", rates.at("in") / 1000.0));
+      status.outgoing_rate = std::string(buf, std::snprintf(buf, sizeof buf, "%.1f", rates.at("out") / 1000.0));
     }
     else
     {
-      ipfs_repo_size_ = 0;
-      ipfs_repo_path_ = "";
-      ipfs_incoming_rate_ = "0.0";
-      ipfs_outgoing_rate_ = "0.0";
+      status.repo_size = 0;
+      status.repo_path = "";
+      status.incoming_rate = "0.0";
+      status.outgoing_rate = "0.0";
     }
 
-    if (ipfs_client_id_.empty())
-      ipfs_client_id_ = ipfs_status_.get_client_id();
-    if (ipfs_client_public_key_.empty())
-      ipfs_client_public_key_ = ipfs_status_.get_client_public_key();
-    if (ipfs_version_.empty())
-      ipfs_version_ = ipfs_status_.get_version();
-
-    // Trigger update of all status fields, in a thread-safe manner
-    Glib::signal_idle().connect_once(sigc::mem_fun(main_window_, &MainWindow::update_status_popover_and_icon));
+    if (status.client_id.empty())
+    {
+      std::map<std::string, std::string> clientInfo = ipfs.get_client_info();
+      status.client_id = clientInfo.at("id");
+      status.client_public_key = clientInfo.at("public-key");
+    }
+    if (status.version.empty())
+      status.version = ipfs.get_version();
   }
   catch (const std::runtime_error& error)
   {
@@ -507,76 +893,153 @@ void Middleware::process_ipfs_status()
     if (errorMessage != "Request was aborted")
     {
       // Assume no connection or connection lost; display disconnected
-      ipfs_number_of_peers_ = 0;
-      ipfs_repo_size_ = 0;
-      ipfs_repo_path_ = "";
-      ipfs_incoming_rate_ = "0.0";
-      ipfs_outgoing_rate_ = "0.0";
-      Glib::signal_idle().connect_once(sigc::mem_fun(main_window_, &MainWindow::update_status_popover_and_icon));
+      status.number_of_peers = 0;
+      status.repo_size = 0;
+      status.repo_path = "";
+      status.incoming_rate = "0.0";
+      status.outgoing_rate = "0.0";
     }
   }
 }
 
 /**
- * Abort request call and stop the thread, if applicable.
+ * \brief Publish a new status snapshot, the main window is only updated when a value is changed
+ * \param status Newest status
  */
-void Middleware::abort_request()
+void Middleware::publish_ipfs_status(const IPFSStatus& status)
 {
-  if (request_thread_ && request_thread_->joinable())
   {
-    if (is_request_thread_done_)
-    {
-      request_thread_->join();
-    }
-    else
-    {
-      // Trigger the thread to stop now.
-      // We call the abort method of the IPFS client.
-      ipfs_fetch_.abort();
-      keep_request_thread_running_ = false;
-      request_thread_->join();
-      // Reset states, allowing new threads with new API requests/calls
-      ipfs_fetch_.reset();
-      keep_request_thread_running_ = true;
-    }
-    delete request_thread_;
-    request_thread_ = nullptr;
-    is_request_thread_done_ = false; // reset
+    std::lock_guard<std::mutex> guard(status_mutex_);
+    if (*ipfs_status_snapshot_ == status)
+      return;
+    ipfs_status_snapshot_ = std::make_shared<const IPFSStatus>(status);
   }
+  // Trigger update of all status fields, in a thread-safe manner
+  Glib::signal_idle().connect_once(sigc::mem_fun(main_window_, &MainWindow::update_status_popover_and_icon));
+}
+
+/**
+ * Abort the on-going request (if applicable), without waiting for the navigation worker to stop the request.
+ * The results of the aborted request are dropped by the main window, since it's no longer the current request.
+ */
+void Middleware::abort_request()
+{
+  request_generation_++;
+  // Cancel the running request, as well as the requests that are still queued
+  executor_.cancel(Executor::LANE_NAVIGATION);
+  // Trigger the request to stop now, the connection is reset again when it's leased by the next request.
+  // We call the abort method of the IPFS client.
+  std::lock_guard<std::mutex> guard(connection_mutex_);
+  if (request_connection_)
+    request_connection_->abort();
 }
 
 /**
- * Abort status calls and stop the thread, if applicable.
+ * Stop the status monitor (and its on-going status calls), without waiting for the status worker.
  */
 void Middleware::abort_status()
 {
-  if (status_thread_ && status_thread_->joinable())
   {
-    if (is_status_thread_done_)
-    {
-      status_thread_->join();
-    }
-    else
-    {
-      // Trigger the thread to stop now.
-      // We call the abort method of the IPFS client.
-      ipfs_status_.abort();
-      status_thread_->join();
-      // Reset states, allowing new threads with new API status calls
-      ipfs_status_.reset();
-    }
-    delete status_thread_;
-    status_thread_ = nullptr;
-    is_status_thread_done_ = false; // reset
+    std::lock_guard<std::mutex> guard(status_mutex_);
+    status_token_.cancel();
   }
+  status_condition_.notify_all();
+  std::lock_guard<std::mutex> guard(connection_mutex_);
+  if (status_connection_)
+    status_connection_->abort();
 }
 
 /**
- * \brief Validate if text is valid UTF-8.
- * \param text String that needs to be validated
- * \return true if valid UTF-8
+ * \brief Pass the content of a request to the GUI thread (see set_request_content()), in order with the document.
+ * Only the pointer is passed, the content itself is shared.
+ * \param content Plain-text content (not parsed)
+ * \param generation Generation number of the request
  */
-bool Middleware::validate_utf8(const Glib::ustring& text)
+void Middleware::post_content(ContentBuffer content, std::size_t generation)
 {
-  return text.validate();
+  Glib::signal_idle().connect_once(sigc::bind(sigc::mem_fun(*this, &Middleware::set_request_content), content, generation));
+}
+
+/**
+ * \brief Show that the content of a request will not be displayed, because it is not text
+ * \param sniffer Content sniffer, with the detected type of the content (eg. "PNG image")
+ * \param generation Generation number of the request
+ */
+void Middleware::post_not_text_message(const ContentSniffer& sniffer, std::size_t generation)
+{
+  Glib::signal_idle().connect_once(sigc::bind(sigc::mem_fun(main_window_, &MainWindow::set_message),
+                                              "😵 File will not be displayed",
+                                              "Detected content: " + sniffer.get_type() +
+                                                  ".\nOnly UTF-8 encoded content can be displayed, like a markdown file or text file.",
+                                              generation));
+}
+
+/**
+ * \brief Store content in the disk cache, the file is written on the background worker
+ * \param cache_key Cache key of the content
+ * \param entry Content and the compiled document (if available)
+ */
+void Middleware::store_in_disk_cache(const std::string& cache_key, const CachedDocument& entry)
+{
+  if (cache_key.empty())
+    return;
+  executor_.post(Executor::LANE_BACKGROUND, [this, cache_key, entry](const CancellationToken&) { disk_cache_.store(cache_key, entry); });
+}
+
+/**
+ * \brief Parse the content and compile the document for drawing, the parsing stops when the request is cancelled
+ * \param content Plain-text content (shared, not copied)
+ * \param token Cancellation token of the request
+ * \return Render document, nullptr when cancelled
+ */
+std::shared_ptr<const RenderDocument> Middleware::parse_document(const ContentBuffer& content, const CancellationToken& token)
+{
+  return parse_document(content->data(), content->size(), token);
+}
+
+/**
+ * \brief Parse the content from a character buffer (eg. a mapped file) and compile the document for drawing,
+ * the parsing stops when the request is cancelled
+ * \param data Pointer to the content
+ * \param length Length of the content in bytes
+ * \param token Cancellation token of the request
+ * \return Render document, nullptr when cancelled
+ */
+std::shared_ptr<const RenderDocument> Middleware::parse_document(const char* data, std::size_t length, const CancellationToken& token)
+{
+  cmark_node* root_node = Parser::parse_content(data, length, token);
+  if (root_node == nullptr)
+    return nullptr;
+  return compile_document(root_node);
+}
+
+/**
+ * \brief Compile the AST document for drawing (see RenderDocument), the AST is freed afterwards
+ * \param root_node AST structure (of type cmark_node)
+ * \return Render document
+ */
+std::shared_ptr<const RenderDocument> Middleware::compile_document(cmark_node* root_node)
+{
+  std::shared_ptr<const RenderDocument> document = RenderDocument::compile(root_node);
+  cmark_node_free(root_node);
+  return document;
+}
+
+/**
+ * \brief Validate if a character buffer (eg. a mapped file) is valid UTF-8, in chunks so the validation stops
+ * soon after it is cancelled. Non-text content is mostly detected within the first bytes.
+ * \param sniffer Content sniffer, holds the detected type of non-text content afterwards
+ * \param data Pointer to the content
+ * \param length Length of the content in bytes
+ * \param token Cancellation token of the request
+ * \return true if valid UTF-8, false when invalid or cancelled
+ */
+bool Middleware::validate_utf8(ContentSniffer& sniffer, const char* data, std::size_t length, const CancellationToken& token)
+{
+  for (std::size_t offset = 0; offset < length; offset += Utf8ValidateChunkSize)
+  {
+    if (token.is_cancelled() || !sniffer.feed(data + offset, std::min(Utf8ValidateChunkSize, length - offset)))
+      return false;
+  }
+  return sniffer.finish();
 }
@@ -1,19 +1,46 @@
 #ifndef MIDDLEWARE_H
 #define MIDDLEWARE_H
 
-#include "ipfs.h"
+#include "disk-cache.h"
+#include "document-cache.h"
+#include "executor.h"
+#include "incremental-parser.h"
+#include "ipfs-pool.h"
 #include "middleware-i.h"
 #include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
 #include <glibmm/dispatcher.h>
 #include <glibmm/ustring.h>
+#include <memory>
 #include <mutex>
-#include <sigc++/connection.h>
 #include <string>
-#include <thread>
 
 /* Forward declarations */
 struct cmark_node;
+class ContentSniffer;
 class MainWindow;
+class RenderDocument;
+
+/**
+ * \struct IPFSStatus
+ * \brief Snapshot of the IPFS connection status, replaced as a whole by the status monitor (never changed afterwards)
+ */
+struct IPFSStatus
+{
+  std::size_t number_of_peers = 0;
+  int repo_size = 0;                 /* Repository size in MB */
+  std::string repo_path;             /* Repository path, empty when disconnected */
+  std::string incoming_rate = "0.0"; /* Incoming rate in kB/s */
+  std::string outgoing_rate = "0.0"; /* Outgoing rate in kB/s */
+  std::string version;               /* IPFS daemon version, empty until known */
+  std::string client_id;             /* IPFS client ID, empty until known */
+  std::string client_public_key;     /* IPFS client public key, empty until known */
+
+  bool operator==(const IPFSStatus& other) const = default;
+  bool is_same_state(const IPFSStatus& other) const;
+};
 
 /**
  * \class Middleware
@@ -22,18 +49,26 @@ class MainWindow;
 class Middleware : public MiddlewareInterface
 {
 public:
-  explicit Middleware(MainWindow& main_window, const std::string& timeout);
+  explicit Middleware(MainWindow& main_window, const ApiAddress& api_address, const std::string& timeout);
   virtual ~Middleware() override;
   void do_request(const std::string& path = std::string(),
                   bool is_set_address_bar = true,
                   bool is_history_request = false,
                   bool is_disable_editor = true,
                   bool is_parse_content = true) override;
+  void restore_request(const std::string& path, ContentBuffer content);
   std::string do_add(const std::string& path) override;
   void do_write(const std::string& path, bool is_set_address_and_title = true) override;
   void set_content(const Glib::ustring& content) override;
-  Glib::ustring get_content() const override;
+  void set_request_content(ContentBuffer content, std::size_t generation);
+  bool is_request_current(std::size_t generation) const;
+  ContentBuffer get_content() const override;
   cmark_node* parse_content() const override;
+  void do_preview(const Glib::ustring& content) override;
+  bool is_preview_current(std::size_t generation) const;
+  void discard_preview();
+  void set_document_cache_limit(std::size_t max_bytes);
+  void set_disk_cache_limit(std::size_t max_bytes);
   void reset_content_and_path() override;
   std::size_t get_ipfs_number_of_peers() const override;
   int get_ipfs_repo_size() const override;
@@ -43,50 +78,67 @@ public:
   std::string get_ipfs_version() const override;
   std::string get_ipfs_client_id() const override;
   std::string get_ipfs_client_public_key() const override;
+  std::shared_ptr<const IPFSStatus> get_ipfs_status() const;
+  void set_status_visible(bool is_visible);
 
 private:
   MainWindow& main_window_;
   Glib::Dispatcher request_started_;
   Glib::Dispatcher request_finished_;
-  sigc::connection status_timer_handler_;
   // Threading:
-  std::thread* request_thread_;                   /* Request thread pointer */
-  std::thread* status_thread_;                    /* Status thread pointer */
-  std::atomic<bool> is_request_thread_done_;      /* Indication when the single request (fetch) is done */
-  std::atomic<bool> keep_request_thread_running_; /* Trigger the request thread to stop/continue */
-  std::atomic<bool> is_status_thread_done_;       /* Indication when the status calls are done */
+  std::atomic<std::size_t> request_generation_; /* Increased for every new (or aborted) request, used to detect stale results */
+  CancellationToken status_token_;              /* Cancellation token of the status monitor */
+  std::mutex preview_mutex_;                    /* Protects the preview snapshot members below */
+  std::condition_variable preview_condition_;   /* Wake-up the waiting preview task on a new snapshot or stop */
+  ContentBuffer preview_content_;               /* Newest editor content snapshot, not yet parsed */
+  std::atomic<std::size_t> preview_generation_; /* Increased for every new snapshot, used to detect stale results */
+  bool is_preview_pending_;                     /* Is there a snapshot waiting to be parsed */
+  bool is_preview_reset_;                       /* Trigger the preview task to forget the previous document */
+  IncrementalParser preview_parser_;            /* Only re-parses the blocks changed by the editor, owned by the parse worker */
 
   // IPFS:
-  std::string ipfs_host_;    /* IPFS host name */
-  int ipfs_port_;            /* IPFS port number */
-  std::string ipfs_timeout_; /* IPFS time-out setting */
-  IPFS ipfs_fetch_;          /* IPFS object for fetch calls */
-  IPFS ipfs_status_;         /* IPFS object for status calls, so it doesn't conflict with the fetch request */
-  std::size_t ipfs_number_of_peers_;
-  int ipfs_repo_size_;
-  std::string ipfs_repo_path_;
-  std::string ipfs_incoming_rate_;
-  std::string ipfs_outgoing_rate_;
-  std::string ipfs_version_;
-  std::string ipfs_client_id_;
-  std::string ipfs_client_public_key_;
-  std::mutex status_mutex_; /* IPFS status mutex to protect class members */
+  ApiAddress ipfs_api_;                                    /* IPFS API address (TCP or unix socket) */
+  std::string ipfs_timeout_;                               /* IPFS time-out setting */
+  IPFSPool ipfs_pool_;                                     /* Keep-alive IPFS connections, leased by the workers (and for publishing) */
+  std::mutex connection_mutex_;                            /* Protects the leased connections below, they are aborted from the GUI thread */
+  IPFSPool::Connection request_connection_;                /* Connection leased by the on-going request, if any */
+  IPFSPool::Connection status_connection_;                 /* Connection leased by the on-going status update, if any */
+  std::shared_ptr<const IPFSStatus> ipfs_status_snapshot_; /* Newest IPFS status, published by the status monitor */
+  std::atomic<bool> is_status_visible_;                    /* Is the main window visible, the status is updated less often otherwise */
+  mutable std::mutex status_mutex_;                        /* Protects the status snapshot, and the status monitor wake-up */
+  std::condition_variable status_condition_;               /* Wake-up the status monitor on stop, or when the window is visible again */
+  DocumentCache document_cache_;                           /* Immutable IPFS content that is fetched before */
+  DiskCache disk_cache_;                                   /* Immutable IPFS content that is fetched before, persistent */
+  Executor executor_;                                      /* Long-lived workers for requests, parsing, background work and status calls */
 
   // Request & Response:
-  std::string request_path_;
-  std::string final_request_path_;
-  Glib::ustring current_content_;
-  bool wait_page_visible_;
+  std::string request_path_;       /* Path of the current request, only used by the GUI thread */
+  std::string final_request_path_; /* Path of the request that is processed, only used by the navigation worker */
+  ContentBuffer current_content_;  /* Content of the current page, only used by the GUI thread */
+  std::atomic<bool> wait_page_visible_;
 
-  void process_request(const std::string& path, bool is_parse_content);
-  void fetch_from_ipfs(bool is_parse_content);
-  void open_from_disk(bool is_parse_content);
-  void do_ipfs_status_update_once();
-  bool do_ipfs_status_update();
-  void process_ipfs_status();
+  void process_request(const std::string& path, std::size_t generation, bool is_parse_content, const CancellationToken& token);
+  void fetch_from_ipfs(std::size_t generation, bool is_parse_content, const CancellationToken& token);
+  bool read_from_local_repo(const std::function<bool(const char* data, std::size_t length)>& chunk_callback,
+                            const CancellationToken& token,
+                            std::size_t& read_length);
+  void open_from_cache(
+      const std::string& cache_key, const CachedDocument& cached, std::size_t generation, bool is_parse_content, const CancellationToken& token);
+  void open_from_disk(std::size_t generation, bool is_parse_content, const CancellationToken& token);
+  void post_content(ContentBuffer content, std::size_t generation);
+  void post_not_text_message(const ContentSniffer& sniffer, std::size_t generation);
+  void store_in_disk_cache(const std::string& cache_key, const CachedDocument& entry);
+  void process_preview(const CancellationToken& token);
+  void monitor_ipfs_status(const CancellationToken& token);
+  bool wait_status_interval(std::chrono::milliseconds interval, const CancellationToken& token);
+  void fetch_ipfs_status(IPFS& ipfs, IPFSStatus& status, bool is_fetch_repo_stats);
+  void publish_ipfs_status(const IPFSStatus& status);
   void abort_request();
   void abort_status();
-  static bool validate_utf8(const Glib::ustring& text);
+  static std::shared_ptr<const RenderDocument> parse_document(const ContentBuffer& content, const CancellationToken& token);
+  static std::shared_ptr<const RenderDocument> parse_document(const char* data, std::size_t length, const CancellationToken& token);
+  static std::shared_ptr<const RenderDocument> compile_document(cmark_node* root_node);
+  static bool validate_utf8(ContentSniffer& sniffer, const char* data, std::size_t length, const CancellationToken& token);
 };
 
 #endif
\ No newline at end of file
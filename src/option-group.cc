@@ -1,6 +1,11 @@
 #include "option-group.h"
 
-OptionGroup::OptionGroup() : Glib::OptionGroup("main_group", "Options", "Options"), timeout("120s"), disable_ipfs_daemon(false), version(false)
+OptionGroup::OptionGroup()
+    : Glib::OptionGroup("main_group", "Options", "Options"),
+      timeout("120s"),
+      api("/ip4/127.0.0.1/tcp/5001"),
+      disable_ipfs_daemon(false),
+      version(false)
 {
   Glib::OptionEntry entry_timeout;
   entry_timeout.set_long_name("timeout");
@@ -9,6 +14,14 @@ OptionGroup::OptionGroup() : Glib::OptionGroup("main_group", "Options", "Options
   entry_timeout.set_arg_description("TIMEOUT");
   add_entry(entry_timeout, timeout);
 
+  Glib::OptionEntry entry_api;
+  entry_api.set_long_name("api");
+  entry_api.set_short_name('a');
+  entry_api.set_description("Change the address of the IPFS API; ADDRESS should be a multiaddr, like /ip4/127.0.0.1/tcp/5001 or a unix socket "
+                            "like /unix/run/ipfs/api.sock (default: /ip4/127.0.0.1/tcp/5001)");
+  entry_api.set_arg_description("ADDRESS");
+  add_entry(entry_api, api);
+
   Glib::OptionEntry entry_disable_ipfs;
   entry_disable_ipfs.set_long_name("disable-ipfs-daemon");
   entry_disable_ipfs.set_short_name('d');
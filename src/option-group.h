@@ -20,6 +20,7 @@ public:
   void on_error(Glib::OptionContext& context, Glib::OptionGroup& group) override;
 
   Glib::ustring timeout;
+  Glib::ustring api;
   bool disable_ipfs_daemon;
   bool version;
 };
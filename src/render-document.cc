@@ -0,0 +1,779 @@
+#include "render-document.h"
+#include "md-parser.h"
+
+#include <algorithm>
+#include <cmark-gfm.h>
+#include <cstring>
+#include <glib.h>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <node.h>
+#include <sstream>
+#include <stdexcept>
+#include <syntax_extension.h>
+
+/**
+ * \class RenderDocument::Compiler
+ * \brief Walks through the AST and translates each node into drawing operations of the render document
+ */
+class RenderDocument::Compiler
+{
+public:
+  explicit Compiler(RenderDocument& document);
+  void process_node(cmark_node* node, cmark_event_type ev_type);
+
+private:
+  enum CodeTypeEnum
+  {
+    CODE_TYPE_NONE = 0,
+    CODE_TYPE_INLINE_CODE,
+    CODE_TYPE_CODE_BLOCK
+  };
+
+  RenderDocument& document_;
+  int heading_level_;
+  int heading_line_;
+  int list_level_;
+  bool is_bold_;
+  bool is_italic_;
+  bool is_strikethrough_;
+  bool is_highlight_;
+  bool is_superscript_;
+  bool is_subscript_;
+  bool is_quote_;
+  int bullet_list_level_;
+  int ordered_list_level_;
+  bool is_ordered_list_;
+  bool is_link_;
+  std::string link_url_;
+  std::map<int, int> ordered_list_counters_;
+  std::map<std::string, std::uint32_t> link_ids_;
+
+  void insert_text(std::string text, const std::string& url = "", CodeTypeEnum code_type = CodeTypeEnum::CODE_TYPE_NONE);
+  void add_text(const std::string& text, std::uint16_t format = FORMAT_NONE);
+  void add_link_text(const std::string& text, const std::string& url);
+  void add_heading_mark(const std::string& text, int heading_level);
+  RenderOp& add_op(RenderOp::OpType type, const std::string& text);
+  void truncate_text(int chars_truncated);
+  static void encode_text(std::string& string);
+  static std::string int_to_roman(int num);
+};
+
+/**
+ * \brief Compile the AST document to drawing operations. Can be called from any thread.
+ * The cmark_node pointer is NOT freed, the caller keeps the ownership.
+ * \param root_node Markdown AST tree
+ * \return Render document
+ */
+std::shared_ptr<const RenderDocument> RenderDocument::compile(cmark_node* root_node)
+{
+  std::shared_ptr<RenderDocument> document(new RenderDocument());
+  Compiler compiler(*document);
+  cmark_event_type ev_type;
+  cmark_iter* iter = cmark_iter_new(root_node);
+  while ((ev_type = cmark_iter_next(iter)) != CMARK_EVENT_DONE)
+  {
+    cmark_node* cur = cmark_iter_get_node(iter);
+    if (ev_type == CMARK_EVENT_ENTER && cmark_node_parent(cur) == root_node)
+    {
+      // Start of the next top-level block
+      std::uint32_t start_line = static_cast<std::uint32_t>(cmark_node_get_start_line(cur));
+      document->blocks_.push_back({Parser::get_fingerprint(cur), static_cast<std::uint32_t>(document->ops_.size()), 0, start_line});
+    }
+    try
+    {
+      compiler.process_node(cur, ev_type);
+    }
+    catch (const std::runtime_error& error)
+    {
+      std::cerr << "ERROR: Processing node failed, with message: " << error.what() << std::endl;
+      // Continue nevertheless
+    }
+  }
+  cmark_iter_free(iter);
+
+  // Each block ends where the next block begins
+  std::uint32_t end_op = static_cast<std::uint32_t>(document->ops_.size());
+  for (auto block = document->blocks_.rbegin(); block != document->blocks_.rend(); ++block)
+  {
+    block->first_op = std::min(block->first_op, end_op);
+    block->op_count = end_op - block->first_op;
+    end_op = block->first_op;
+  }
+  return document;
+}
+
+/**
+ * \brief Get all drawing operations
+ * \return Operations in document order
+ */
+const std::vector<RenderOp>& RenderDocument::get_ops() const
+{
+  return ops_;
+}
+
+/**
+ * \brief Get the top-level blocks, which refer to their range of drawing operations
+ * \return Blocks in document order
+ */
+const std::vector<RenderBlock>& RenderDocument::get_blocks() const
+{
+  return blocks_;
+}
+
+/**
+ * \brief Get the text of an operation (not null-terminated, see text_length)
+ * \param op Drawing operation of this document
+ * \return Pointer to the text
+ */
+const char* RenderDocument::get_text(const RenderOp& op) const
+{
+  return text_.data() + op.text_offset;
+}
+
+/**
+ * \brief Get the link URL of a link operation
+ * \param op Drawing operation of this document
+ * \return URL
+ */
+const std::string& RenderDocument::get_link(const RenderOp& op) const
+{
+  return links_.at(op.link);
+}
+
+/**
+ * \brief Read a document that is serialized before (see serialize()), the data is validated so the document can be
+ * drawn safely
+ * \param data Serialized document
+ * \param size Size in bytes
+ * \return Render document, or nullptr if the data is invalid
+ */
+std::shared_ptr<const RenderDocument> RenderDocument::deserialize(const char* data, std::size_t size)
+{
+  const char* end = data + size;
+  auto read = [&data, end](void* value, std::size_t length)
+  {
+    if (static_cast<std::size_t>(end - data) < length)
+      return false;
+    std::memcpy(value, data, length);
+    data += length;
+    return true;
+  };
+  std::uint64_t text_length;
+  std::uint32_t op_count, block_count, link_count;
+  if (!read(&text_length, sizeof(text_length)) || !read(&op_count, sizeof(op_count)) || !read(&block_count, sizeof(block_count)) ||
+      !read(&link_count, sizeof(link_count)))
+    return nullptr;
+  // Check the sizes first, before any memory is allocated
+  std::size_t remaining = static_cast<std::size_t>(end - data);
+  if (text_length > remaining || op_count > remaining / sizeof(RenderOp) || block_count > remaining / sizeof(RenderBlock) ||
+      link_count > remaining / sizeof(std::uint32_t))
+    return nullptr;
+
+  std::shared_ptr<RenderDocument> document(new RenderDocument());
+  document->text_.resize(text_length);
+  document->ops_.resize(op_count);
+  document->blocks_.resize(block_count);
+  document->links_.resize(link_count);
+  if (!read(document->text_.data(), text_length) || !read(document->ops_.data(), op_count * sizeof(RenderOp)) ||
+      !read(document->blocks_.data(), block_count * sizeof(RenderBlock)))
+    return nullptr;
+  for (std::string& link : document->links_)
+  {
+    std::uint32_t link_length;
+    if (!read(&link_length, sizeof(link_length)) || link_length > static_cast<std::size_t>(end - data))
+      return nullptr;
+    link.assign(data, link_length);
+    data += link_length;
+  }
+  if (data != end)
+    return nullptr;
+
+  // The text and the links are inserted in the text buffer as-is, which requires valid UTF-8
+  if (!g_utf8_validate(document->text_.data(), static_cast<gssize>(text_length), nullptr))
+    return nullptr;
+  for (const std::string& link : document->links_)
+  {
+    if (!g_utf8_validate(link.data(), static_cast<gssize>(link.size()), nullptr))
+      return nullptr;
+  }
+  // Validate all references, the text of an operation starts and ends at a character boundary
+  auto is_boundary = [&document](std::uint64_t offset)
+  { return offset == document->text_.size() || (static_cast<unsigned char>(document->text_[offset]) & 0xC0) != 0x80; };
+  for (const RenderOp& op : document->ops_)
+  {
+    if (op.type > RenderOp::OP_HEADING || op.text_offset > text_length || op.text_length > text_length - op.text_offset ||
+        (op.type == RenderOp::OP_LINK && op.link >= link_count))
+      return nullptr;
+    if (!is_boundary(op.text_offset) || !is_boundary(static_cast<std::uint64_t>(op.text_offset) + op.text_length))
+      return nullptr;
+    if (op.type == RenderOp::OP_HEADING &&
+        (op.heading_level < 1 || op.heading_level > 6 || op.source_line > static_cast<std::uint32_t>(std::numeric_limits<int>::max())))
+      return nullptr;
+  }
+  for (const RenderBlock& block : document->blocks_)
+  {
+    if (block.first_op > op_count || block.op_count > op_count - block.first_op)
+      return nullptr;
+  }
+  return document;
+}
+
+/**
+ * \brief Get the (approximate) memory usage of the document
+ * \return Number of bytes
+ */
+std::size_t RenderDocument::get_memory_usage() const
+{
+  std::size_t bytes = sizeof(RenderDocument) + text_.capacity() + ops_.capacity() * sizeof(RenderOp) + blocks_.capacity() * sizeof(RenderBlock);
+  for (const std::string& link : links_)
+  {
+    bytes += sizeof(std::string) + link.capacity();
+  }
+  return bytes;
+}
+
+/**
+ * \brief Append the document in a flat binary format to the output (see deserialize()).
+ * The format uses the native byte order, and is only meant for the cache on this machine.
+ * \param out Output
+ */
+void RenderDocument::serialize(std::string& out) const
+{
+  auto write = [&out](const void* value, std::size_t length) { out.append(static_cast<const char*>(value), length); };
+  std::uint64_t text_length = text_.size();
+  std::uint32_t op_count = static_cast<std::uint32_t>(ops_.size());
+  std::uint32_t block_count = static_cast<std::uint32_t>(blocks_.size());
+  std::uint32_t link_count = static_cast<std::uint32_t>(links_.size());
+  write(&text_length, sizeof(text_length));
+  write(&op_count, sizeof(op_count));
+  write(&block_count, sizeof(block_count));
+  write(&link_count, sizeof(link_count));
+  write(text_.data(), text_.size());
+  write(ops_.data(), ops_.size() * sizeof(RenderOp));
+  write(blocks_.data(), blocks_.size() * sizeof(RenderBlock));
+  for (const std::string& link : links_)
+  {
+    std::uint32_t link_length = static_cast<std::uint32_t>(link.size());
+    write(&link_length, sizeof(link_length));
+    write(link.data(), link.size());
+  }
+}
+
+RenderDocument::Compiler::Compiler(RenderDocument& document)
+    : document_(document),
+      heading_level_(0),
+      heading_line_(0),
+      list_level_(0),
+      is_bold_(false),
+      is_italic_(false),
+      is_strikethrough_(false),
+      is_highlight_(false),
+      is_superscript_(false),
+      is_subscript_(false),
+      is_quote_(false),
+      bullet_list_level_(0),
+      ordered_list_level_(0),
+      is_ordered_list_(false),
+      is_link_(false)
+{
+}
+
+/**
+ * Process and parse each node in the AST
+ */
+void RenderDocument::Compiler::process_node(cmark_node* node, cmark_event_type ev_type)
+{
+  bool entering = (ev_type == CMARK_EVENT_ENTER);
+
+  // Take care of the markdown extensions
+  if (node->extension)
+  {
+    if (strcmp(node->extension->name, "strikethrough") == 0)
+    {
+      is_strikethrough_ = entering;
+      return;
+    }
+    else if (strcmp(node->extension->name, "highlight") == 0)
+    {
+      is_highlight_ = entering;
+      return;
+    }
+    else if (strcmp(node->extension->name, "superscript") == 0)
+    {
+      is_superscript_ = entering;
+      return;
+    }
+    else if (strcmp(node->extension->name, "subscript") == 0)
+    {
+      is_subscript_ = entering;
+      return;
+    }
+  }
+
+  switch (node->type)
+  {
+  case CMARK_NODE_DOCUMENT:
+    if (entering)
+    {
+      // Reset all (better safe than sorry)
+      heading_level_ = 0;
+      bullet_list_level_ = 0;
+      ordered_list_level_ = 0;
+      list_level_ = 0;
+      is_ordered_list_ = false;
+      is_bold_ = false;
+      is_italic_ = false;
+      is_strikethrough_ = false;
+      is_highlight_ = false;
+      is_superscript_ = false;
+      is_subscript_ = false;
+      is_quote_ = false;
+    }
+    break;
+
+  case CMARK_NODE_BLOCK_QUOTE:
+    is_quote_ = entering;
+    if (!entering)
+    {
+      // Replace last quote '|'-sign with a normal blank line
+      this->truncate_text(2);
+      this->add_text("\n");
+    }
+    break;
+
+  case CMARK_NODE_LIST:
+  {
+    cmark_list_type listType = node->as.list.list_type;
+
+    if (entering)
+    {
+      list_level_++;
+    }
+    else
+    {
+      list_level_--;
+    }
+    if (list_level_ == 0)
+    {
+      // Reset bullet/ordered levels
+      bullet_list_level_ = 0;
+      ordered_list_level_ = 0;
+      is_ordered_list_ = false;
+      if (!entering)
+        this->add_text("\n");
+    }
+    else if (list_level_ > 0)
+    {
+      if (entering)
+      {
+        if (listType == cmark_list_type::CMARK_BULLET_LIST)
+        {
+          bullet_list_level_++;
+        }
+        else if (listType == cmark_list_type::CMARK_ORDERED_LIST)
+        {
+          ordered_list_level_++;
+          // Create the counter (and reset to zero)
+          ordered_list_counters_[ordered_list_level_] = 0;
+        }
+      }
+      else
+      {
+        // Un-indent list level again
+        if (listType == cmark_list_type::CMARK_BULLET_LIST)
+        {
+          bullet_list_level_--;
+        }
+        else if (listType == cmark_list_type::CMARK_ORDERED_LIST)
+        {
+          ordered_list_level_--;
+        }
+      }
+
+      is_ordered_list_ = (ordered_list_level_ > 0) && (bullet_list_level_ <= 0);
+    }
+  }
+  break;
+
+  case CMARK_NODE_ITEM:
+    if (entering)
+    {
+      if (is_ordered_list_)
+      {
+        // Increasement ordered list counter
+        ordered_list_counters_[ordered_list_level_]++;
+      }
+
+      // Insert tabs & bullet/number
+      if (bullet_list_level_ > 0)
+      {
+        if (bullet_list_level_ % 2 == 0)
+        {
+          this->insert_text(std::string(bullet_list_level_, '\t') + "\u25e6 ");
+        }
+        else
+        {
+          this->insert_text(std::string(bullet_list_level_, '\t') + "\u2022 ");
+        }
+      }
+      else if (ordered_list_level_ > 0)
+      {
+        std::string number;
+        if (ordered_list_level_ % 2 == 0)
+        {
+          number = int_to_roman(ordered_list_counters_[ordered_list_level_]) + " ";
+        }
+        else
+        {
+          number = std::to_string(ordered_list_counters_[ordered_list_level_]) + ". ";
+        }
+        this->insert_text(std::string(ordered_list_level_, '\t') + number);
+      }
+    }
+    break;
+
+  case CMARK_NODE_HEADING:
+    if (entering)
+    {
+      heading_level_ = node->as.heading.level;
+      heading_line_ = cmark_node_get_start_line(node);
+    }
+    else
+    {
+      // Insert line break after heading
+      this->add_text("\n\n");
+      heading_level_ = 0; // reset
+    }
+    break;
+
+  case CMARK_NODE_CODE_BLOCK:
+  {
+    std::string code = cmark_node_get_literal(node);
+    std::string newline = (is_quote_) ? "" : "\n";
+    this->insert_text(code + newline, "", CodeTypeEnum::CODE_TYPE_CODE_BLOCK);
+  }
+  break;
+
+  case CMARK_NODE_HTML_BLOCK:
+    break;
+
+  case CMARK_NODE_CUSTOM_BLOCK:
+    break;
+
+  case CMARK_NODE_THEMATIC_BREAK:
+  {
+    is_bold_ = true;
+    this->insert_text("\u2015\u2015\u2015\u2015\u2015\u2015\u2015\u2015\u2015\u2015\u2015\u2015\u2015\u2015\u2015"
+                      "\u2015\u2015\u2015\u2015\u2015\u2015\u2015\u2015\u2015\n\n");
+    is_bold_ = false;
+  }
+  break;
+
+  case CMARK_NODE_PARAGRAPH:
+    // For listings only insert a single new line
+    if (!entering && (list_level_ > 0))
+    {
+      this->add_text("\n");
+    }
+    // Dealing with paragraphs in quotes
+    else if (entering && is_quote_)
+    {
+      this->insert_text("\uFF5C ");
+    }
+    else if (!entering && is_quote_)
+    {
+      this->insert_text("\n\uFF5C\n");
+    }
+    // Normal paragraph, just blank line
+    else if (!entering)
+    {
+      this->add_text("\n\n");
+    }
+    break;
+
+  case CMARK_NODE_TEXT:
+  {
+    std::string text = cmark_node_get_literal(node);
+    // URL
+    if (is_link_)
+    {
+      this->insert_text(text, link_url_);
+      link_url_ = "";
+    }
+    // Text (with optional inline formatting)
+    else
+    {
+      this->insert_text(text);
+    }
+  }
+  break;
+
+  case CMARK_NODE_LINEBREAK:
+    // Hard brake
+    this->add_text("\n");
+    break;
+
+  case CMARK_NODE_SOFTBREAK:
+    // only insert space
+    this->add_text(" ");
+    break;
+
+  case CMARK_NODE_CODE:
+  {
+    std::string code = cmark_node_get_literal(node);
+    this->insert_text(code, "", CodeTypeEnum::CODE_TYPE_INLINE_CODE);
+  }
+  break;
+
+  case CMARK_NODE_HTML_INLINE:
+    break;
+
+  case CMARK_NODE_CUSTOM_INLINE:
+    break;
+
+  case CMARK_NODE_STRONG:
+    is_bold_ = entering;
+    break;
+
+  case CMARK_NODE_EMPH:
+    is_italic_ = entering;
+    break;
+
+  case CMARK_NODE_LINK:
+    is_link_ = entering;
+    if (entering)
+    {
+      link_url_ = cmark_node_get_url(node);
+    }
+    break;
+
+  case CMARK_NODE_IMAGE:
+    break;
+
+  case CMARK_NODE_FOOTNOTE_REFERENCE:
+    break;
+
+  case CMARK_NODE_FOOTNOTE_DEFINITION:
+    break;
+  default:
+    throw std::runtime_error("Node type '" + std::string(cmark_node_get_type_string(node)) + "' not found.");
+    break;
+  }
+}
+
+/**
+ * Add text with the current formatting (or a link when the URL is not empty)
+ */
+void RenderDocument::Compiler::insert_text(std::string text, const std::string& url, CodeTypeEnum code_type)
+{
+  std::uint16_t format = FORMAT_NONE;
+
+  // Use by reference to replace the string
+  // TODO: For normal text, you want to bring back the '&amp;' to '&' symbol again
+  encode_text(text);
+
+  if (is_strikethrough_)
+  {
+    format |= FORMAT_STRIKETHROUGH;
+  }
+  if (is_superscript_)
+  {
+    format |= FORMAT_SUPERSCRIPT;
+  }
+  // You can not have superscript & subscript applied together
+  else if (is_subscript_)
+  {
+    format |= FORMAT_SUBSCRIPT;
+  }
+  if (is_bold_)
+  {
+    format |= FORMAT_BOLD;
+  }
+  if (is_italic_)
+  {
+    format |= FORMAT_ITALIC;
+  }
+  if (is_highlight_)
+  {
+    format |= FORMAT_HIGHLIGHT;
+  }
+  if (code_type != CodeTypeEnum::CODE_TYPE_NONE)
+  {
+    format |= FORMAT_CODE;
+  }
+  if (heading_level_ > 0)
+  {
+    format |= heading_level_ << FORMAT_HEADING_SHIFT;
+    // Already add the mark for the heading
+    add_heading_mark(text, heading_level_);
+  }
+  if (is_quote_)
+  {
+    format |= FORMAT_QUOTE;
+  }
+
+  // Insert text (+ headings)
+  if (url.empty())
+  {
+    // Special case for code blocks within quote
+    if ((code_type == CodeTypeEnum::CODE_TYPE_CODE_BLOCK) && is_quote_)
+    {
+      std::istringstream iss(text);
+      std::string line;
+      // Add a quote for each new code line
+      while (getline(iss, line))
+      {
+        add_text("\uFF5C ", FORMAT_QUOTE);
+        add_text(line + "\n", format);
+      }
+      add_text("\uFF5C\n", FORMAT_QUOTE);
+    }
+    // Special case for heading within quote
+    else if ((heading_level_ > 0) && is_quote_)
+    {
+      add_text("\uFF5C ", FORMAT_QUOTE);
+      add_text(text, format);
+    }
+    else
+    {
+      // Just insert text (default) - which includes headings as well
+      add_text(text, format);
+    }
+  }
+  // Insert URL to text
+  else
+  {
+    add_link_text(text, url);
+  }
+}
+
+/**
+ * Add text operation, text with the same formatting directly after each other within a block is merged into one operation
+ */
+void RenderDocument::Compiler::add_text(const std::string& text, std::uint16_t format)
+{
+  if (text.empty())
+    return;
+  std::vector<RenderOp>& ops = document_.ops_;
+  std::uint32_t block_first_op = document_.blocks_.empty() ? 0 : document_.blocks_.back().first_op;
+  if (ops.size() > block_first_op)
+  {
+    RenderOp& last_op = ops.back();
+    if (last_op.type == RenderOp::OP_TEXT && last_op.format == format && last_op.text_offset + last_op.text_length == document_.text_.size())
+    {
+      document_.text_.append(text);
+      last_op.text_length += static_cast<std::uint32_t>(text.size());
+      return;
+    }
+  }
+  add_op(RenderOp::OP_TEXT, text).format = format;
+}
+
+/**
+ * Add link text operation, links with the same URL share the same link index
+ */
+void RenderDocument::Compiler::add_link_text(const std::string& text, const std::string& url)
+{
+  auto result = link_ids_.try_emplace(url, static_cast<std::uint32_t>(document_.links_.size()));
+  if (result.second)
+    document_.links_.push_back(url);
+  add_op(RenderOp::OP_LINK, text).link = result.first->second;
+}
+
+/**
+ * \brief Add mark for heading (ToC)
+ */
+void RenderDocument::Compiler::add_heading_mark(const std::string& text, int heading_level)
+{
+  RenderOp& op = add_op(RenderOp::OP_HEADING, text);
+  op.heading_level = static_cast<std::uint8_t>(heading_level);
+  op.source_line = static_cast<std::uint32_t>(heading_line_);
+}
+
+/**
+ * Append operation, the text is added to the text pool. The other fields are zero, the caller sets the fields of the type.
+ */
+RenderOp& RenderDocument::Compiler::add_op(RenderOp::OpType type, const std::string& text)
+{
+  RenderOp op;
+  std::memset(&op, 0, sizeof(op)); // Also clear the padding, the operations are serialized as-is
+  op.type = type;
+  op.text_offset = static_cast<std::uint32_t>(document_.text_.size());
+  op.text_length = static_cast<std::uint32_t>(text.size());
+  document_.text_.append(text);
+  document_.ops_.push_back(op);
+  return document_.ops_.back();
+}
+
+/**
+ * Remove nr. chars (UTF-8) from the end of the text added so far
+ */
+void RenderDocument::Compiler::truncate_text(int chars_truncated)
+{
+  std::vector<RenderOp>& ops = document_.ops_;
+  for (auto op = ops.rbegin(); op != ops.rend() && chars_truncated > 0; ++op)
+  {
+    if (op->type == RenderOp::OP_HEADING)
+      continue;
+    const char* begin = document_.text_.data() + op->text_offset;
+    const char* end = begin + op->text_length;
+    while (chars_truncated > 0 && end > begin)
+    {
+      // Skip UTF-8 continuation bytes
+      do
+      {
+        --end;
+      } while (end > begin && (static_cast<unsigned char>(*end) & 0xC0) == 0x80);
+      --chars_truncated;
+    }
+    op->text_length = static_cast<std::uint32_t>(end - begin);
+  }
+  while (!ops.empty() && ops.back().type != RenderOp::OP_HEADING && ops.back().text_length == 0)
+  {
+    ops.pop_back();
+  }
+}
+
+/**
+ * Encode text string (eg. ampersand-character)
+ * @param[in/out] string
+ */
+void RenderDocument::Compiler::encode_text(std::string& string)
+{
+  std::string buffer;
+  buffer.reserve(string.size() + 5);
+  for (size_t pos = 0; pos != string.size(); ++pos)
+  {
+    switch (string[pos])
+    {
+    case '&':
+      buffer.append("&amp;");
+      break;
+    default:
+      buffer.append(&string[pos], 1);
+      break;
+    }
+  }
+  string.swap(buffer);
+}
+
+/**
+ * Convert number to roman numerals
+ */
+std::string RenderDocument::Compiler::int_to_roman(int num)
+{
+  static const int values[] = {1000, 900, 500, 400, 100, 90, 50, 40, 10, 9, 5, 4, 1};
+  static const std::string numerals[] = {"M", "CM", "D", "CD", "C", "XC", "L", "XL", "X", "IX", "V", "IV", "I"};
+  std::string res;
+  for (int i = 0; i < 13; ++i)
+  {
+    while (num >= values[i])
+    {
+      num -= values[i];
+      res += numerals[i];
+    }
+  }
+  return res;
+}
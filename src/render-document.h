@@ -0,0 +1,97 @@
+#ifndef RENDER_DOCUMENT_H
+#define RENDER_DOCUMENT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+/* Forward declarations */
+struct cmark_node;
+
+/**
+ * \brief Text formatting flags, each combination of flags corresponds to a set of text tags.
+ * The heading level (1-6) is stored in the heading bits.
+ */
+enum TextFormat : std::uint16_t
+{
+  FORMAT_NONE = 0,
+  FORMAT_BOLD = 1 << 0,
+  FORMAT_ITALIC = 1 << 1,
+  FORMAT_STRIKETHROUGH = 1 << 2,
+  FORMAT_SUPERSCRIPT = 1 << 3,
+  FORMAT_SUBSCRIPT = 1 << 4,
+  FORMAT_HIGHLIGHT = 1 << 5,
+  FORMAT_CODE = 1 << 6,
+  FORMAT_QUOTE = 1 << 7,
+  FORMAT_HEADING_SHIFT = 8,
+  FORMAT_HEADING_MASK = 7 << FORMAT_HEADING_SHIFT
+};
+
+/**
+ * \struct RenderOp
+ * \brief Single drawing operation, the text is stored in the text pool of the render document
+ */
+struct RenderOp
+{
+  enum OpType : std::uint8_t
+  {
+    OP_TEXT = 0, /* Insert text with the text formatting flags */
+    OP_LINK,     /* Insert link text, pointing to the link URL */
+    OP_HEADING   /* Add heading (ToC) at the current position, the text is the heading title */
+  };
+  OpType type;
+  std::uint8_t heading_level; /* Heading level (1-6), only for OP_HEADING */
+  std::uint16_t format;       /* Text formatting flags (see TextFormat), only for OP_TEXT */
+  union
+  {
+    std::uint32_t link;        /* Index of the link URL, only for OP_LINK */
+    std::uint32_t source_line; /* Line number in the markdown source (0 if unknown), only for OP_HEADING */
+  };
+  std::uint32_t text_offset;  /* Byte offset in the text pool */
+  std::uint32_t text_length;  /* Length in bytes */
+};
+
+/**
+ * \struct RenderBlock
+ * \brief Top-level block of the document, with the range of operations to draw the block
+ */
+struct RenderBlock
+{
+  std::uint64_t fingerprint; /* See Parser::get_fingerprint() */
+  std::uint32_t first_op;    /* Index of the first operation of the block */
+  std::uint32_t op_count;    /* Number of operations (can be zero, eg. HTML blocks) */
+  std::uint32_t start_line;  /* Line number of the block in the markdown source */
+};
+
+/**
+ * \class RenderDocument
+ * \brief Markdown document compiled to a flat list of drawing operations (see Draw).
+ * Compiling can be done in any thread, the document is immutable afterwards and can be drawn again later (eg. from history).
+ */
+class RenderDocument
+{
+public:
+  static std::shared_ptr<const RenderDocument> compile(cmark_node* root_node);
+  static std::shared_ptr<const RenderDocument> deserialize(const char* data, std::size_t size);
+
+  const std::vector<RenderOp>& get_ops() const;
+  const std::vector<RenderBlock>& get_blocks() const;
+  const char* get_text(const RenderOp& op) const;
+  const std::string& get_link(const RenderOp& op) const;
+  std::size_t get_memory_usage() const;
+  void serialize(std::string& out) const;
+
+private:
+  class Compiler;
+
+  std::string text_;                /* Text pool of all operations */
+  std::vector<RenderOp> ops_;       /* Drawing operations */
+  std::vector<RenderBlock> blocks_; /* Top-level blocks, in document order */
+  std::vector<std::string> links_;  /* Unique link URLs */
+
+  RenderDocument() = default;
+};
+
+#endif
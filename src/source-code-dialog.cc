@@ -31,7 +31,7 @@ SourceCodeDialog::~SourceCodeDialog()
 void SourceCodeDialog::set_text(const std::string& text)
 {
   Glib::RefPtr<Gtk::TextBuffer> buffer = source_code.get_buffer();
-  buffer->set_text(text);
+  buffer->set_text(text.data(), text.data() + text.size());
 }
 
 /**
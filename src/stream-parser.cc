@@ -0,0 +1,151 @@
+#include "stream-parser.h"
+#include "md-parser.h"
+
+#include <glib.h>
+#include <node.h>
+#include <parser.h>
+#include <utility>
+
+StreamParser::StreamParser()
+    : parser_(Parser::create_parser()),
+      line_offsets_{0},
+      last_finished_(nullptr),
+      fed_offset_(0),
+      finished_offset_(0),
+      is_streaming_(true)
+{
+}
+
+StreamParser::~StreamParser()
+{
+  stop();
+}
+
+/**
+ * \brief Feed the next chunk of content.
+ * Note: Do not forgot to execute: cmark_node_free(document); when you are done with the returned document.
+ * \param data Pointer to the chunk
+ * \param length Length of the chunk in bytes
+ * \return AST structure (of type cmark_node) with the top-level blocks that are finished since the previous call,
+ * or nullptr when no new block is finished (or when streaming is stopped)
+ */
+cmark_node* StreamParser::feed(const char* data, std::size_t length)
+{
+  std::size_t old_size = content_.size();
+  content_.append(data, length);
+  if (!is_streaming_ || length == 0)
+    return nullptr;
+
+  // Link reference definitions are resolved in the whole document, blocks can't be displayed before the end is received
+  std::size_t check_offset = (old_size > 0) ? old_size - 1 : 0;
+  if (Parser::has_reference_definition(content_.data() + check_offset, content_.size() - check_offset))
+  {
+    stop();
+    return nullptr;
+  }
+  for (std::size_t pos = check_offset; pos < content_.size(); ++pos)
+  {
+    if (content_[pos] == '\n' && pos >= old_size)
+    {
+      line_offsets_.push_back(pos + 1);
+    }
+    else if (content_[pos] == '\r' && pos + 1 < content_.size() && content_[pos + 1] != '\n')
+    {
+      // Lone carriage returns are line endings for cmark, not supported by the line offsets
+      stop();
+      return nullptr;
+    }
+  }
+  // Hold back a trailing carriage return, cmark processes the line immediately while the line feed might still follow
+  std::size_t feed_end = (content_.back() == '\r') ? content_.size() - 1 : content_.size();
+  cmark_parser_feed(parser_, content_.data() + fed_offset_, feed_end - fed_offset_);
+  fed_offset_ = feed_end;
+
+  // Find the top-level blocks that are closed since the previous call, these blocks will not change anymore
+  cmark_node* node = (last_finished_ == nullptr) ? cmark_node_first_child(parser_->root) : cmark_node_next(last_finished_);
+  cmark_node* last_closed = nullptr;
+  while (node != nullptr && !(node->flags & CMARK_NODE__OPEN))
+  {
+    last_closed = node;
+    node = cmark_node_next(node);
+  }
+  if (last_closed == nullptr)
+    return nullptr;
+
+  // The finished part ends where the next (still open) block starts, or after the last processed line
+  std::size_t end_offset = (node != nullptr) ? line_offsets_[node->start_line - 1] : line_offsets_.back();
+  const char* finished = content_.data() + finished_offset_;
+  std::size_t finished_length = end_offset - finished_offset_;
+  if (!g_utf8_validate(finished, finished_length, nullptr))
+  {
+    stop();
+    return nullptr;
+  }
+  cmark_node* document = Parser::parse_content(finished, finished_length);
+  last_finished_ = last_closed;
+  finished_offset_ = end_offset;
+  return document;
+}
+
+/**
+ * \brief Parse the remaining content, after everything is received. Streaming is stopped.
+ * Note: Do not forgot to execute: cmark_node_free(document); when you are done with the returned document.
+ * \return AST structure (of type cmark_node) with the top-level blocks not returned by feed() yet,
+ * or nullptr when streaming was already stopped (parse the whole content instead)
+ */
+cmark_node* StreamParser::finish()
+{
+  if (!is_streaming_)
+    return nullptr;
+  const char* remaining = content_.data() + finished_offset_;
+  std::size_t remaining_length = content_.size() - finished_offset_;
+  stop();
+  if (!g_utf8_validate(remaining, remaining_length, nullptr))
+    return nullptr;
+  finished_offset_ = content_.size();
+  return Parser::parse_content(remaining, remaining_length);
+}
+
+/**
+ * \brief Get the content received so far
+ * \return Content (not validated)
+ */
+const std::string& StreamParser::get_content() const
+{
+  return content_;
+}
+
+/**
+ * \brief Take the received content out of the parser without copying it, call finish() first.
+ * The parser can't be used afterwards.
+ * \return Content (not validated)
+ */
+std::string StreamParser::release_content()
+{
+  is_streaming_ = false;
+  return std::move(content_);
+}
+
+/**
+ * \brief Check if finished blocks are still returned by feed()
+ * \return true if streaming, false when the content needs to be parsed as a whole after receiving
+ */
+bool StreamParser::is_streaming() const
+{
+  return is_streaming_;
+}
+
+/**
+ * \brief Stop streaming, the content is still collected
+ */
+void StreamParser::stop()
+{
+  is_streaming_ = false;
+  if (parser_ != nullptr)
+  {
+    cmark_parser_free(parser_);
+    parser_ = nullptr;
+  }
+  line_offsets_.clear();
+  last_finished_ = nullptr;
+}
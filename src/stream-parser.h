@@ -0,0 +1,43 @@
+#ifndef STREAM_PARSER_H
+#define STREAM_PARSER_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+/* Forward declarations */
+struct cmark_node;
+struct cmark_parser;
+
+/**
+ * \class StreamParser
+ * \brief Parse markdown content while it is still being received (eg. downloading from IPFS).
+ * The top-level blocks that are finished are returned as soon as possible, so they can already be displayed.
+ */
+class StreamParser
+{
+public:
+  StreamParser();
+  ~StreamParser();
+  StreamParser(const StreamParser&) = delete;
+  StreamParser& operator=(const StreamParser&) = delete;
+
+  cmark_node* feed(const char* data, std::size_t length);
+  cmark_node* finish();
+  const std::string& get_content() const;
+  std::string release_content();
+  bool is_streaming() const;
+
+private:
+  cmark_parser* parser_;                  /* Parser that is fed with all the content, only used to find the finished blocks */
+  std::string content_;                   /* Content received so far */
+  std::vector<std::size_t> line_offsets_; /* Byte offset of each line start */
+  cmark_node* last_finished_;             /* Last top-level block returned by feed() */
+  std::size_t fed_offset_;                /* Byte offset until where the content is fed to the parser */
+  std::size_t finished_offset_;           /* Byte offset until where the content is returned by feed() */
+  bool is_streaming_;                     /* Stop streaming when blocks can't be parsed on their own anymore */
+
+  void stop();
+};
+
+#endif
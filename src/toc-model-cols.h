@@ -12,13 +12,13 @@ class TocModelCols : public Gtk::TreeModel::ColumnRecord
 public:
   TocModelCols()
   {
-    add(col_iter);
+    add(col_index);
     add(col_level);
     add(col_heading);
     add(col_valid);
   }
 
-  Gtk::TreeModelColumn<Gtk::TextIter> col_iter;
+  Gtk::TreeModelColumn<unsigned int> col_index; /* Index of the heading (see Draw::get_headings()) */
   Gtk::TreeModelColumn<int> col_level;
   Gtk::TreeModelColumn<Glib::ustring> col_heading;
   Gtk::TreeModelColumn<bool> col_valid;
@@ -0,0 +1,322 @@
+#include "undo-history.h"
+
+// Number of unused bytes in the text arena that are kept, before the arena is compacted
+static const std::size_t ArenaSpareBytes = 64 * 1024;
+
+/**
+ * \brief Constructor
+ * \param max_bytes Memory limit of the history (text and bookkeeping)
+ */
+UndoHistory::UndoHistory(std::size_t max_bytes)
+    : max_bytes_(max_bytes),
+      text_bytes_(0),
+      edit_count_(0),
+      action_depth_(0),
+      is_coalescing_allowed_(false)
+{
+}
+
+/**
+ * \brief Change the memory limit, the oldest undo steps are dropped directly when needed
+ * \param max_bytes Memory limit of the history (text and bookkeeping)
+ */
+void UndoHistory::set_max_bytes(std::size_t max_bytes)
+{
+  max_bytes_ = max_bytes;
+  enforce_limit();
+}
+
+/**
+ * \brief Start of a user action, all the changes until the end of the (outer) user action are one undo step
+ */
+void UndoHistory::begin_action()
+{
+  if (action_depth_++ == 0)
+  {
+    undo_steps_.push_back({STEP_OTHER, {}});
+  }
+}
+
+/**
+ * \brief End of a user action, a single typed or deleted character is coalesced with the previous undo step
+ * (if possible)
+ */
+void UndoHistory::end_action()
+{
+  if (action_depth_ == 0 || --action_depth_ > 0)
+    return;
+
+  UndoStep& step = undo_steps_.back();
+  if (step.edits.empty())
+  {
+    undo_steps_.pop_back();
+    return;
+  }
+  if (step.edits.size() == 1)
+  {
+    const UndoEdit& edit = step.edits.front();
+    // A new line always starts a new undo step
+    bool is_single_char = (edit.end_offset - edit.begin_offset == 1) && !(edit.text_length == 1 && arena_[edit.text_offset] == '\n');
+    if (is_single_char)
+      step.type = (edit.is_insert) ? STEP_TYPING : STEP_DELETING;
+  }
+  coalesce();
+  enforce_limit();
+}
+
+/**
+ * \brief Add inserted text
+ * \param offset Character offset of the inserted text
+ * \param text Inserted text
+ * \param char_count Number of characters of the inserted text
+ */
+void UndoHistory::add_insert(int offset, const std::string& text, int char_count)
+{
+  add_edit(true, offset, offset + char_count, text);
+}
+
+/**
+ * \brief Add deleted text
+ * \param begin_offset Character offset of the first deleted character
+ * \param end_offset Character offset after the last deleted character
+ * \param text Deleted text
+ */
+void UndoHistory::add_delete(int begin_offset, int end_offset, const std::string& text)
+{
+  add_edit(false, begin_offset, end_offset, text);
+}
+
+/**
+ * \brief Undo the last undo step, the step is moved to the redo steps.
+ * The caller needs to revert the edits in reverse order.
+ * \return Edits of the undo step, valid until the history is changed again. Or nullptr if there is nothing to undo
+ */
+const std::vector<UndoEdit>* UndoHistory::undo()
+{
+  if (action_depth_ > 0 || undo_steps_.empty())
+    return nullptr;
+  redo_steps_.push_back(std::move(undo_steps_.back()));
+  undo_steps_.pop_back();
+  is_coalescing_allowed_ = false;
+  return &redo_steps_.back().edits;
+}
+
+/**
+ * \brief Redo the last undone step, the step is moved back to the undo steps.
+ * The caller needs to apply the edits in order.
+ * \return Edits of the undo step, valid until the history is changed again. Or nullptr if there is nothing to redo
+ */
+const std::vector<UndoEdit>* UndoHistory::redo()
+{
+  if (action_depth_ > 0 || redo_steps_.empty())
+    return nullptr;
+  undo_steps_.push_back(std::move(redo_steps_.back()));
+  redo_steps_.pop_back();
+  is_coalescing_allowed_ = false;
+  return &undo_steps_.back().edits;
+}
+
+/**
+ * \brief Get the text of an edit
+ * \param edit Edit of this history
+ * \return Pointer to the text (text_length bytes, not null-terminated)
+ */
+const char* UndoHistory::get_text(const UndoEdit& edit) const
+{
+  return arena_.data() + edit.text_offset;
+}
+
+/**
+ * \brief Remove all undo and redo steps
+ */
+void UndoHistory::clear()
+{
+  undo_steps_.clear();
+  redo_steps_.clear();
+  arena_.clear();
+  arena_.shrink_to_fit();
+  text_bytes_ = 0;
+  edit_count_ = 0;
+  action_depth_ = 0;
+  is_coalescing_allowed_ = false;
+}
+
+/**
+ * \brief Get the number of undo steps
+ */
+std::size_t UndoHistory::get_undo_count() const
+{
+  return undo_steps_.size();
+}
+
+/**
+ * \brief Get the number of redo steps
+ */
+std::size_t UndoHistory::get_redo_count() const
+{
+  return redo_steps_.size();
+}
+
+/**
+ * \brief Get the (approximate) memory footprint of the history, including the unused part of the text arena
+ * \return Number of bytes
+ */
+std::size_t UndoHistory::get_memory_usage() const
+{
+  return sizeof(UndoHistory) + arena_.capacity() + edit_count_ * sizeof(UndoEdit) + (undo_steps_.size() + redo_steps_.capacity()) * sizeof(UndoStep);
+}
+
+/**
+ * Add edit to the current undo step (or a new step outside a user action), the redo steps are dropped
+ */
+void UndoHistory::add_edit(bool is_insert, int begin_offset, int end_offset, const std::string& text)
+{
+  if (text.empty())
+    return;
+  bool is_outside_action = (action_depth_ == 0);
+  if (is_outside_action)
+    begin_action();
+  for (const UndoStep& step : redo_steps_)
+  {
+    forget_step(step);
+  }
+  redo_steps_.clear();
+
+  UndoStep& step = undo_steps_.back();
+  UndoEdit edit = {is_insert, begin_offset, end_offset, arena_.size(), text.size()};
+  arena_.append(text);
+  text_bytes_ += text.size();
+  // Continued typing within the same user action (eg. input methods) is merged into a single edit
+  UndoEdit* last_edit = (step.edits.empty()) ? nullptr : &step.edits.back();
+  if (is_insert && last_edit != nullptr && last_edit->is_insert && last_edit->end_offset == begin_offset &&
+      last_edit->text_offset + last_edit->text_length == edit.text_offset)
+  {
+    last_edit->end_offset = end_offset;
+    last_edit->text_length += edit.text_length;
+  }
+  else
+  {
+    step.edits.push_back(edit);
+    ++edit_count_;
+  }
+  if (is_outside_action)
+    end_action();
+}
+
+/**
+ * Coalesce the last undo step with the step before it, when both are typing (or deleting) character after character
+ */
+void UndoHistory::coalesce()
+{
+  bool is_allowed = is_coalescing_allowed_;
+  StepType type = undo_steps_.back().type;
+  is_coalescing_allowed_ = (type != STEP_OTHER);
+  if (!is_allowed || type == STEP_OTHER || undo_steps_.size() < 2)
+    return;
+  UndoStep& previous = undo_steps_[undo_steps_.size() - 2];
+  if (previous.type != type)
+    return;
+
+  const UndoEdit& edit = undo_steps_.back().edits.front();
+  UndoEdit& last_edit = previous.edits.back();
+  bool is_text_adjacent = (last_edit.text_offset + last_edit.text_length == edit.text_offset);
+  if (type == STEP_TYPING && last_edit.end_offset == edit.begin_offset)
+  {
+    if (is_text_adjacent)
+    {
+      last_edit.end_offset = edit.end_offset;
+      last_edit.text_length += edit.text_length;
+      --edit_count_;
+    }
+    else
+    {
+      previous.edits.push_back(edit);
+    }
+  }
+  else if (type == STEP_DELETING && last_edit.begin_offset == edit.begin_offset && is_text_adjacent)
+  {
+    // Delete key, the deleted text is directly after the text deleted before
+    last_edit.end_offset += edit.end_offset - edit.begin_offset;
+    last_edit.text_length += edit.text_length;
+    --edit_count_;
+  }
+  else if (type == STEP_DELETING && last_edit.begin_offset == edit.end_offset)
+  {
+    // Backspace, the deleted text is in front of the text deleted before. Reverted first, so inserted in front again.
+    previous.edits.push_back(edit);
+  }
+  else
+  {
+    return;
+  }
+  undo_steps_.pop_back();
+}
+
+/**
+ * Drop the oldest undo steps until the history is within the memory limit, the last undo step is always kept.
+ * The redo steps are dropped first.
+ */
+void UndoHistory::enforce_limit()
+{
+  if (action_depth_ > 0)
+    return;
+  while (get_used_bytes() > max_bytes_ && !redo_steps_.empty())
+  {
+    forget_step(redo_steps_.front());
+    redo_steps_.erase(redo_steps_.begin());
+  }
+  while (get_used_bytes() > max_bytes_ && undo_steps_.size() > 1)
+  {
+    forget_step(undo_steps_.front());
+    undo_steps_.pop_front();
+  }
+  if (arena_.size() > 2 * text_bytes_ + ArenaSpareBytes)
+    compact_arena();
+}
+
+/**
+ * Copy the text of the remaining steps into a new text arena
+ */
+void UndoHistory::compact_arena()
+{
+  std::string arena;
+  arena.reserve(text_bytes_);
+  auto copy_text = [this, &arena](UndoStep& step)
+  {
+    for (UndoEdit& edit : step.edits)
+    {
+      std::size_t text_offset = arena.size();
+      arena.append(arena_, edit.text_offset, edit.text_length);
+      edit.text_offset = text_offset;
+    }
+  };
+  for (UndoStep& step : undo_steps_)
+  {
+    copy_text(step);
+  }
+  for (UndoStep& step : redo_steps_)
+  {
+    copy_text(step);
+  }
+  arena_ = std::move(arena);
+}
+
+/**
+ * Update the memory accounting for a step that is going to be removed
+ */
+void UndoHistory::forget_step(const UndoStep& step)
+{
+  for (const UndoEdit& edit : step.edits)
+  {
+    text_bytes_ -= edit.text_length;
+  }
+  edit_count_ -= step.edits.size();
+}
+
+/**
+ * Bytes used by the undo and redo steps (text and bookkeeping), the unused part of the text arena is not included
+ */
+std::size_t UndoHistory::get_used_bytes() const
+{
+  return text_bytes_ + edit_count_ * sizeof(UndoEdit) + (undo_steps_.size() + redo_steps_.size()) * sizeof(UndoStep);
+}
@@ -0,0 +1,84 @@
+#ifndef UNDO_HISTORY_H
+#define UNDO_HISTORY_H
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <vector>
+
+/**
+ * \struct UndoEdit
+ * \brief Single text change, the text is stored in the text arena of the undo history
+ */
+struct UndoEdit
+{
+  bool is_insert;          /* Inserted text, otherwise deleted text */
+  int begin_offset;        /* Character offset of the first character */
+  int end_offset;          /* Character offset after the last character */
+  std::size_t text_offset; /* Byte offset in the text arena */
+  std::size_t text_length; /* Length in bytes */
+};
+
+/**
+ * \class UndoHistory
+ * \brief Undo/redo history of the editor. All changes during a user action are grouped into one undo step, and typing
+ * (or deleting) character by character is coalesced into one undo step as well.
+ * The text of the changes is stored in a single text arena, the oldest undo steps are dropped when the history
+ * uses more memory than the limit.
+ */
+class UndoHistory
+{
+public:
+  explicit UndoHistory(std::size_t max_bytes = DefaultMaxBytes);
+  void set_max_bytes(std::size_t max_bytes);
+  void begin_action();
+  void end_action();
+  void add_insert(int offset, const std::string& text, int char_count);
+  void add_delete(int begin_offset, int end_offset, const std::string& text);
+  const std::vector<UndoEdit>* undo();
+  const std::vector<UndoEdit>* redo();
+  const char* get_text(const UndoEdit& edit) const;
+  void clear();
+  std::size_t get_undo_count() const;
+  std::size_t get_redo_count() const;
+  std::size_t get_memory_usage() const;
+
+  static const std::size_t DefaultMaxBytes = 16 * 1024 * 1024;
+
+private:
+  enum StepType
+  {
+    STEP_OTHER = 0, /* Any other change, never coalesced */
+    STEP_TYPING,    /* Single character is typed */
+    STEP_DELETING   /* Single character is deleted */
+  };
+
+  /**
+   * \struct UndoStep
+   * \brief Changes that are undone/redone at once
+   */
+  struct UndoStep
+  {
+    StepType type;
+    std::vector<UndoEdit> edits;
+  };
+
+  std::size_t max_bytes_;
+  std::string arena_;       /* Text of all the changes in the history, also of dropped steps until compacted */
+  std::size_t text_bytes_;  /* Bytes in the arena that are referred to by the steps */
+  std::size_t edit_count_;  /* Number of edits of all the steps */
+  std::deque<UndoStep> undo_steps_;
+  std::vector<UndoStep> redo_steps_;
+  int action_depth_;
+  bool is_coalescing_allowed_; /* Last undo step can be extended by the next step */
+
+  void add_edit(bool is_insert, int begin_offset, int end_offset, const std::string& text);
+  void coalesce();
+  void enforce_limit();
+  void compact_arena();
+  void forget_step(const UndoStep& step);
+  std::size_t get_used_bytes() const;
+};
+
+#endif
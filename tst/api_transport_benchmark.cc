@@ -0,0 +1,76 @@
+/**
+ * Latency of small IPFS API calls over TCP compared to a unix domain socket.
+ * Without arguments a local test server is used for both transports, which measures the transport overhead only.
+ * Pass two API multiaddrs to compare against a running IPFS daemon instead, eg:
+ *   api_transport_benchmark /ip4/127.0.0.1/tcp/5001 /unix/home/user/.ipfs/api.sock
+ */
+#include "api-transport.h"
+#include "http-test-server.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+// Calls before measuring (connection setup, caches), and the number of measured calls
+static const int WarmUpCalls = 100;
+static const int MeasuredCalls = 5000;
+
+/**
+ * Measure the latency of the small 'version' call, prints the median, 99th percentile and mean in microseconds
+ */
+static void benchmark(const std::string& name, const ApiAddress& address)
+{
+  ApiTransport transport(address);
+  std::string url = address.get_base_url() + "/api/v0/version";
+  std::size_t received = 0;
+  auto count = [&received](const char*, std::size_t length) { received += length; };
+  for (int i = 0; i < WarmUpCalls; ++i)
+    transport.post(url, count);
+
+  std::vector<double> latencies;
+  latencies.reserve(MeasuredCalls);
+  for (int i = 0; i < MeasuredCalls; ++i)
+  {
+    auto start = std::chrono::steady_clock::now();
+    transport.post(url, count);
+    latencies.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count());
+  }
+  std::sort(latencies.begin(), latencies.end());
+  double total = 0;
+  for (double latency : latencies)
+    total += latency;
+  std::printf("%-12s median: %8.1f us   p99: %8.1f us   mean: %8.1f us\n", name.c_str(), latencies[latencies.size() / 2],
+              latencies[latencies.size() * 99 / 100], total / latencies.size());
+}
+
+int main(int argc, char* argv[])
+{
+  try
+  {
+    if (argc == 3)
+    {
+      benchmark("tcp", ApiAddress::parse(argv[1]));
+      benchmark("unix socket", ApiAddress::parse(argv[2]));
+      return 0;
+    }
+    std::string body = "{\"Version\":\"0.18.1\",\"Commit\":\"\",\"Repo\":\"13\",\"System\":\"amd64/linux\",\"Golang\":\"go1.19.1\"}";
+    std::string socket_path = "/tmp/libreweb-benchmark-" + std::to_string(::getpid()) + ".sock";
+    {
+      HttpTestServer server(body);
+      benchmark("tcp", ApiAddress::parse("/ip4/127.0.0.1/tcp/" + std::to_string(server.get_port())));
+    }
+    {
+      HttpTestServer server(body, socket_path);
+      benchmark("unix socket", ApiAddress::parse("/unix" + socket_path));
+    }
+  }
+  catch (const std::exception& error)
+  {
+    std::fprintf(stderr, "ERROR: %s\n", error.what());
+    return 1;
+  }
+  return 0;
+}
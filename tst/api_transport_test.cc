@@ -0,0 +1,85 @@
+#include "api-transport.h"
+#include "http-test-server.h"
+#include "gtest/gtest.h"
+#include <stdexcept>
+#include <string>
+#include <unistd.h>
+
+namespace
+{
+  TEST(LibreWebTest, TestApiAddressParse)
+  {
+    // Given
+    std::string tcp = "/ip4/127.0.0.1/tcp/5001";
+    std::string ip6 = "/ip6/::1/tcp/5002/http";
+    std::string unix_socket = "/unix/run/ipfs/api.sock";
+
+    // When
+    ApiAddress tcp_address = ApiAddress::parse(tcp);
+    ApiAddress ip6_address = ApiAddress::parse(ip6);
+    ApiAddress unix_address = ApiAddress::parse(unix_socket);
+
+    // Then
+    ASSERT_FALSE(tcp_address.is_unix_socket());
+    ASSERT_TRUE(tcp_address.is_local());
+    ASSERT_EQ(tcp_address.get_base_url(), "http://127.0.0.1:5001");
+    ASSERT_EQ(ip6_address.get_base_url(), "http://[::1]:5002");
+    ASSERT_TRUE(unix_address.is_unix_socket());
+    ASSERT_TRUE(unix_address.is_local());
+    ASSERT_FALSE(ApiAddress::parse("/dns/ipfs.example.com/tcp/5001").is_local());
+    ASSERT_EQ(unix_address.socket_path, "/run/ipfs/api.sock");
+  }
+
+  TEST(LibreWebTest, TestApiAddressParseUnsupported)
+  {
+    // Given
+    std::string missing_port = "/ip4/127.0.0.1/tcp";
+    std::string udp = "/ip4/127.0.0.1/udp/5001";
+    std::string host_name = "localhost:5001";
+
+    // When & Then
+    ASSERT_THROW(ApiAddress::parse(missing_port), std::invalid_argument);
+    ASSERT_THROW(ApiAddress::parse(udp), std::invalid_argument);
+    ASSERT_THROW(ApiAddress::parse(host_name), std::invalid_argument);
+    ASSERT_THROW(ApiAddress::parse("/unix/"), std::invalid_argument);
+  }
+
+  TEST(LibreWebTest, TestApiTransportUnixSocket)
+  {
+    // Given
+    std::string socket_path = "/tmp/libreweb-test-" + std::to_string(::getpid()) + ".sock";
+    HttpTestServer server("{\"Version\":\"0.18.1\"}", socket_path);
+    ApiAddress address = ApiAddress::parse("/unix" + socket_path);
+    ApiTransport transport(address);
+    std::string response;
+
+    // When
+    for (int i = 0; i < 3; ++i)
+    {
+      response.clear();
+      transport.post(address.get_base_url() + "/api/v0/version", [&response](const char* data, std::size_t length) { response.append(data, length); });
+    }
+
+    // Then
+    ASSERT_EQ(response, "{\"Version\":\"0.18.1\"}");
+    // The connection is kept alive between the calls
+    ASSERT_EQ(server.get_connection_count(), 1);
+  }
+
+  TEST(LibreWebTest, TestApiTransportStop)
+  {
+    // Given
+    HttpTestServer server("{}");
+    ApiAddress address = ApiAddress::parse("/ip4/127.0.0.1/tcp/" + std::to_string(server.get_port()));
+    ApiTransport transport(address);
+    auto ignore = [](const char*, std::size_t) {};
+
+    // When
+    transport.stop();
+
+    // Then
+    ASSERT_THROW(transport.post(address.get_base_url() + "/api/v0/id", ignore), std::runtime_error);
+    transport.reset();
+    ASSERT_NO_THROW(transport.post(address.get_base_url() + "/api/v0/id", ignore));
+  }
+} // namespace
@@ -1,6 +1,7 @@
 #include "draw.h"
 #include "md-parser.h"
 #include "mock-middleware.h"
+#include "render-document.h"
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 #include <gtkmm/application.h>
@@ -35,18 +36,75 @@ namespace
     // Given
     std::string markdown = "**Hello** *world*";
     cmark_node* doc = Parser::parse_content(markdown);
+    auto document = RenderDocument::compile(doc);
+    cmark_node_free(doc);
 
     MockMiddleware middleware;
     Draw draw(middleware);
 
     // When
-    draw.set_document(doc);
+    draw.set_document(document);
 
     // Then
     std::string result = draw.get_text();
     ASSERT_EQ(result, "Hello world\n\n");
   }
 
+  TEST_F(DrawFixture, TestDrawUpdateDocument)
+  {
+    // Given
+    std::string markdown = "# Title\n\nFirst **paragraph**\n\n## Sub title\n\nLast paragraph";
+    std::string changed_markdown = "# Title\n\nFirst *changed* paragraph\n\n- item\n\n## Sub title\n\nLast paragraph";
+    cmark_node* doc = Parser::parse_content(markdown);
+    cmark_node* changed_doc = Parser::parse_content(changed_markdown);
+    auto document = RenderDocument::compile(doc);
+    auto changed_document = RenderDocument::compile(changed_doc);
+    cmark_node_free(doc);
+    cmark_node_free(changed_doc);
+
+    MockMiddleware middleware;
+    Draw draw(middleware);
+
+    // When
+    draw.update_document(document);
+    std::size_t first_changed_heading = draw.update_document(changed_document);
+
+    // Then
+    std::string result = draw.get_text();
+    ASSERT_EQ(result, "Title\n\nFirst changed paragraph\n\n\t\u2022 item\n\nSub title\n\nLast paragraph\n\n");
+    // The first heading is in front of the changed block
+    ASSERT_EQ(first_changed_heading, 1U);
+    auto headings = draw.get_headings();
+    ASSERT_EQ(headings.size(), 2U);
+    ASSERT_EQ(headings.at(0).offset, 0);
+    ASSERT_EQ(headings.at(1).offset, 41);
+    ASSERT_EQ(headings.at(1).level, 2);
+    ASSERT_EQ(headings.at(1).source_line, 7);
+    ASSERT_EQ(draw.get_heading_title(headings.at(1)), "Sub title");
+  }
+
+  TEST_F(DrawFixture, TestDrawLinks)
+  {
+    // Given
+    std::string markdown = "[First](ipfs://first) and [second](ipfs://second)";
+    cmark_node* doc = Parser::parse_content(markdown);
+    auto document = RenderDocument::compile(doc);
+    cmark_node_free(doc);
+    MockMiddleware middleware;
+    Draw draw(middleware);
+    int tag_table_size = draw.get_buffer()->get_tag_table()->get_size();
+
+    // When
+    draw.set_document(document);
+    draw.set_document(document);
+
+    // Then
+    ASSERT_EQ(draw.get_text(), "First and second\n\n");
+    // All links share the same link tag
+    ASSERT_EQ(draw.get_buffer()->get_tag_table()->get_size(), tag_table_size);
+    ASSERT_TRUE(draw.get_buffer()->get_iter_at_offset(12).has_tag(draw.get_buffer()->get_tag_table()->lookup("link")));
+  }
+
   TEST_F(DrawFixture, TestDrawTextTags)
   {
     // Given
@@ -121,11 +179,13 @@ namespace
     std::string markdown = "**bold**~~strikethrough~~^up^%down%`code`";
     gsize length = 0;
     cmark_node* doc = Parser::parse_content(markdown);
+    auto document = RenderDocument::compile(doc);
+    cmark_node_free(doc);
     MockMiddleware middleware;
     Draw draw(middleware);
 
     // When
-    draw.set_document(doc);
+    draw.set_document(document);
     auto buffer = draw.get_buffer();
     // Using the built-in formatter
     guint8* data = buffer->serialize(buffer, "application/x-gtk-text-buffer-rich-text", buffer->begin(), buffer->end(), length);
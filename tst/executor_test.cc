@@ -0,0 +1,118 @@
+#include "executor.h"
+#include "gtest/gtest.h"
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace
+{
+  /**
+   * Wait until the tasks that are queued on the lane so far are finished (or skipped, when cancelled)
+   */
+  void wait_for_lane(Executor& executor, Executor::Lane lane)
+  {
+    std::promise<void> finished;
+    executor.post(lane, [&finished](const CancellationToken&) { finished.set_value(); });
+    finished.get_future().wait();
+  }
+
+  TEST(LibreWebTest, TestExecutorRunsTasksInOrder)
+  {
+    // Given
+    Executor executor;
+    std::mutex mutex;
+    std::vector<int> order;
+
+    // When
+    for (int i = 0; i < 5; ++i)
+    {
+      executor.post(Executor::LANE_NAVIGATION,
+                    [&, i](const CancellationToken&)
+                    {
+                      std::lock_guard<std::mutex> guard(mutex);
+                      order.push_back(i);
+                    });
+    }
+    wait_for_lane(executor, Executor::LANE_NAVIGATION);
+
+    // Then
+    ASSERT_EQ(order, std::vector<int>({0, 1, 2, 3, 4}));
+  }
+
+  TEST(LibreWebTest, TestExecutorSkipsCancelledTask)
+  {
+    // Given
+    Executor executor;
+    std::atomic<bool> is_blocked(true);
+    std::atomic<int> run_count(0);
+    executor.post(Executor::LANE_NAVIGATION,
+                  [&](const CancellationToken&)
+                  {
+                    while (is_blocked)
+                      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                  });
+    CancellationToken token = executor.post(Executor::LANE_NAVIGATION, [&](const CancellationToken&) { run_count++; });
+
+    // When
+    token.cancel();
+    is_blocked = false;
+    wait_for_lane(executor, Executor::LANE_NAVIGATION);
+
+    // Then
+    ASSERT_TRUE(token.is_cancelled());
+    ASSERT_EQ(run_count, 0);
+  }
+
+  TEST(LibreWebTest, TestExecutorCancelRunningTask)
+  {
+    // Given
+    Executor executor;
+    std::atomic<bool> is_started(false);
+    std::atomic<bool> is_stopped(false);
+    executor.post(Executor::LANE_STATUS,
+                  [&](const CancellationToken& token)
+                  {
+                    is_started = true;
+                    while (!token.is_cancelled())
+                      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                    is_stopped = true;
+                  });
+    while (!is_started)
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+    // When
+    executor.cancel(Executor::LANE_STATUS);
+    wait_for_lane(executor, Executor::LANE_STATUS);
+
+    // Then
+    ASSERT_TRUE(is_stopped);
+  }
+
+  TEST(LibreWebTest, TestExecutorLanesAreIndependent)
+  {
+    // Given
+    Executor executor;
+    std::atomic<bool> is_blocked(true);
+    std::atomic<bool> is_status_done(false);
+    std::atomic<bool> is_done(false);
+    executor.post(Executor::LANE_STATUS,
+                  [&](const CancellationToken&)
+                  {
+                    while (is_blocked)
+                      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                    is_status_done = true;
+                  });
+
+    // When
+    executor.post(Executor::LANE_NAVIGATION, [&](const CancellationToken&) { is_done = true; });
+    wait_for_lane(executor, Executor::LANE_NAVIGATION);
+
+    // Then
+    ASSERT_TRUE(is_done);
+    ASSERT_FALSE(is_status_done);
+    is_blocked = false;
+  }
+} // namespace
@@ -1,5 +1,6 @@
 #include "file.h"
 #include "gtest/gtest.h"
+#include <cstdio>
 #include <string>
 namespace
 {
@@ -13,4 +14,26 @@ namespace
     // Then
     ASSERT_EQ(filename, expected_filename);
   }
+
+  TEST(LibreWebTest, TestMapFile)
+  {
+    // Given
+    std::string path = testing::TempDir() + "libreweb_map_test.md";
+    std::string content = "# Title\n\nSome **text**.\n";
+    File::write(path, content);
+    // When
+    std::unique_ptr<MappedFile> file = File::map(path);
+    // Then
+    ASSERT_TRUE(file->is_open());
+    ASSERT_EQ(std::string(file->data(), file->size()), content);
+    std::remove(path.c_str());
+  }
+
+  TEST(LibreWebTest, TestMapMissingFile)
+  {
+    // Given
+    std::string path = testing::TempDir() + "libreweb_missing_file.md";
+    // When & Then
+    ASSERT_THROW(File::map(path), std::runtime_error);
+  }
 } // namespace
\ No newline at end of file
@@ -0,0 +1,158 @@
+#ifndef HTTP_TEST_SERVER_H
+#define HTTP_TEST_SERVER_H
+
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <stdexcept>
+#include <string>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+/**
+ * \class HttpTestServer
+ * \brief Minimal keep-alive HTTP server for the API transport tests, listening on the TCP loopback or on a unix socket.
+ * Every request is answered with the same JSON body, the connections are handled one at a time.
+ */
+class HttpTestServer
+{
+public:
+  /**
+   * \brief Start listening on an ephemeral TCP port of the loopback interface
+   * \param body Response body of every request
+   */
+  explicit HttpTestServer(const std::string& body)
+      : body_(body),
+        port_(0),
+        is_stopping_(false)
+  {
+    listen_fd_ = ::socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (::bind(listen_fd_, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0)
+      throw std::runtime_error("Could not bind the test server");
+    socklen_t length = sizeof(address);
+    ::getsockname(listen_fd_, reinterpret_cast<sockaddr*>(&address), &length);
+    port_ = ntohs(address.sin_port);
+    start();
+  }
+
+  /**
+   * \brief Start listening on a unix socket, an existing socket file is replaced
+   * \param body Response body of every request
+   * \param socket_path Path of the unix socket
+   */
+  HttpTestServer(const std::string& body, const std::string& socket_path)
+      : body_(body),
+        socket_path_(socket_path),
+        port_(0),
+        is_stopping_(false)
+  {
+    listen_fd_ = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    std::strncpy(address.sun_path, socket_path.c_str(), sizeof(address.sun_path) - 1);
+    ::unlink(socket_path.c_str());
+    if (::bind(listen_fd_, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0)
+      throw std::runtime_error("Could not bind the test server");
+    start();
+  }
+
+  ~HttpTestServer()
+  {
+    is_stopping_ = true;
+    ::shutdown(listen_fd_, SHUT_RDWR);
+    ::close(listen_fd_);
+    thread_.join();
+    if (!socket_path_.empty())
+      ::unlink(socket_path_.c_str());
+  }
+
+  int get_port() const
+  {
+    return port_;
+  }
+
+  /**
+   * \brief Get the number of accepted connections (a keep-alive client only needs one)
+   */
+  int get_connection_count() const
+  {
+    return connection_count_;
+  }
+
+private:
+  std::string body_;
+  std::string socket_path_;
+  int port_;
+  int listen_fd_;
+  std::atomic<bool> is_stopping_;
+  std::atomic<int> connection_count_ = 0;
+  std::thread thread_;
+
+  void start()
+  {
+    ::listen(listen_fd_, 16);
+    thread_ = std::thread(&HttpTestServer::run, this);
+  }
+
+  void run()
+  {
+    while (!is_stopping_)
+    {
+      int fd = ::accept(listen_fd_, nullptr, nullptr);
+      if (fd < 0)
+        break;
+      connection_count_++;
+      if (socket_path_.empty())
+      {
+        int flag = 1;
+        ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag));
+      }
+      serve(fd);
+      ::close(fd);
+    }
+  }
+
+  /** Answer the requests of a connection, until the client closes it */
+  void serve(int fd)
+  {
+    std::string received;
+    std::vector<char> buffer(16384);
+    for (;;)
+    {
+      std::size_t header_end = received.find("\r\n\r\n");
+      if (header_end == std::string::npos)
+      {
+        ssize_t length = ::recv(fd, buffer.data(), buffer.size(), 0);
+        if (length <= 0)
+          return;
+        received.append(buffer.data(), static_cast<std::size_t>(length));
+        continue;
+      }
+      std::size_t content_length = 0;
+      std::size_t field = received.find("Content-Length: ");
+      if (field != std::string::npos && field < header_end)
+        content_length = std::stoul(received.substr(field + 16));
+      while (received.size() < header_end + 4 + content_length)
+      {
+        ssize_t length = ::recv(fd, buffer.data(), buffer.size(), 0);
+        if (length <= 0)
+          return;
+        received.append(buffer.data(), static_cast<std::size_t>(length));
+      }
+      received.erase(0, header_end + 4 + content_length);
+      std::string response = "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\nContent-Length: " + std::to_string(body_.size()) + "\r\n\r\n" + body_;
+      if (::send(fd, response.data(), response.size(), MSG_NOSIGNAL) < 0)
+        return;
+    }
+  }
+};
+
+#endif
@@ -0,0 +1,62 @@
+#include "json-scanner.h"
+#include "gtest/gtest.h"
+#include <string>
+
+namespace
+{
+  TEST(LibreWebTest, TestJsonScannerValues)
+  {
+    // Given
+    std::string json = "{\"RepoSize\": 5000000000, \"RepoPath\": \"/home/user/.ipfs\", \"Version\": \"fs-repo@12\","
+                       " \"Nested\": {\"RepoPath\": \"/other\"}, \"Quote\": \"a \\\"b\\\" \\u00e9\", \"Flag\": true}";
+    JsonScanner scanner;
+
+    // When
+    scanner.feed(json.data(), json.size());
+
+    // Then
+    ASSERT_EQ(scanner.get_value("RepoSize"), "5000000000");
+    ASSERT_EQ(scanner.get_value("RepoPath"), "/home/user/.ipfs");
+    ASSERT_EQ(scanner.get_value("Version"), "fs-repo@12");
+    ASSERT_EQ(scanner.get_value("Quote"), "a \"b\" \xC3\xA9");
+    ASSERT_EQ(scanner.get_value("Flag"), "true");
+    ASSERT_EQ(scanner.get_value("Missing"), "");
+  }
+
+  TEST(LibreWebTest, TestJsonScannerArraySizeInChunks)
+  {
+    // Given
+    std::string json = "{\"Peers\":[{\"Addr\":\"/ip4/1.2.3.4/tcp/4001\",\"Peer\":\"Qm1\",\"Streams\":[{\"Protocol\":\"a]\"}]},"
+                       "{\"Addr\":\"/ip4/5.6.7.8/udp/4001\",\"Peer\":\"Qm2\",\"Latency\":\"\"},"
+                       "{\"Addr\":\"/ip6/::1/tcp/4001\",\"Peer\":\"Qm{3\",\"Streams\":null}],\"Count\":3}";
+    JsonScanner scanner;
+
+    // When
+    // Feed byte by byte, like a response that is received in small chunks
+    for (char c : json)
+    {
+      scanner.feed(&c, 1);
+    }
+
+    // Then
+    ASSERT_EQ(scanner.get_array_size("Peers"), 3);
+    ASSERT_EQ(scanner.get_value("Count"), "3");
+  }
+
+  TEST(LibreWebTest, TestJsonScannerEmptyArrays)
+  {
+    // Given
+    std::string empty = "{\"Peers\": [ ]}";
+    std::string null = "{\"Peers\": null}";
+    JsonScanner empty_scanner, null_scanner;
+
+    // When
+    empty_scanner.feed(empty.data(), empty.size());
+    null_scanner.feed(null.data(), null.size());
+
+    // Then
+    ASSERT_EQ(empty_scanner.get_array_size("Peers"), 0);
+    ASSERT_EQ(null_scanner.get_array_size("Peers"), 0);
+    ASSERT_EQ(null_scanner.get_value("Peers"), "null");
+  }
+} // namespace
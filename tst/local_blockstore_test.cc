@@ -0,0 +1,258 @@
+#include "executor.h"
+#include "file.h"
+#include "local-blockstore.h"
+#include "gtest/gtest.h"
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+namespace
+{
+  // Markdown file of two raw leaves ("# Title\n\n" and "Some **text**.\n"), linked by a dag-pb root node
+  const char* const RootCidV0 = "QmaS6Ga347B9FVYD4TrDWN3PpabwyKVvMqFSQMWDynFLfw";
+  const char* const RootCidV1 = "bafybeiftwegdc2oxefuy7zeixhacog3rlylbpsnnbjh7wkup63z3jn3q7y";
+  const char* const RootBlock = "122a0a2401551220d07e786edc925a6748c76ca1d1fd44e6b7aa583b429ecd5146b26a81daee85b312001809"
+                                "122a0a24015512208eb19bc2e49b4d0574fa3f50a9426ea597d025d034da75577773844f16d3970d1200180f"
+                                "0a08080218182009200f";
+  const char* const LeafCid = "bafkreigqpz4g5xesljturr3muhi72rhgw6vfqo2ct3gvcrvsnka5v3ufwm";
+  // Empty UnixFS directory, which is in every IPFS repository
+  const char* const EmptyDirectoryCid = "QmUNLLsPACCz1vLxQVkXqqLX5R1X345qqfHbsf67hvA3Nn";
+
+  /**
+   * Create a flatfs repository with the blocks of the markdown file and the empty directory
+   */
+  std::string create_repository(const std::string& name)
+  {
+    std::string repo_path = testing::TempDir() + name;
+    std::filesystem::path blocks = std::filesystem::path(repo_path) / "blocks";
+    for (const char* shard : {"B7", "LM", "OD", "X3"})
+      std::filesystem::create_directories(blocks / shard);
+    File::write((blocks / "SHARDING").string(), "/repo/flatfs/shard/v1/next-to-last/2\n");
+    std::string root;
+    for (const char* hex = RootBlock; hex[0] != '\0'; hex += 2)
+      root += static_cast<char>(std::stoi(std::string(hex, 2), nullptr, 16));
+    File::write((blocks / "B7" / "CIQLHMIMGFU5OILJR7SIROOAE4NXCXQWC7E22CSP7MVI75XTWS3XB7Q.data").string(), root);
+    File::write((blocks / "LM" / "CIQNA7TYN3OJEWTHJDDWZIOR7VCONN5KLA5UFHWNKFDLE2UB3LXILMY.data").string(), "# Title\n\n");
+    File::write((blocks / "OD" / "CIQI5MM3YLSJWTIFOT5D6UFJIJXKLF6QEXIDJWTVK53XHBCPC3JZODI.data").string(), "Some **text**.\n");
+    File::write((blocks / "X3" / "CIQFTFEEHEDF6KLBT32BFAGLXEZL4UWFNWM4LFTLMXQBCERZ6CMLX3Y.data").string(), std::string("\x0a\x02\x08\x01", 4));
+    return repo_path;
+  }
+
+  /**
+   * Encode as base32 (upper case, without padding), like the block file names
+   */
+  std::string encode_base32(const std::string& bytes)
+  {
+    const char* const alphabet = "ABCDEFGHIJKLMNOPQRSTUVWXYZ234567";
+    std::string text;
+    std::uint32_t buffer = 0;
+    int bits = 0;
+    for (char byte : bytes)
+    {
+      buffer = (buffer << 8) | static_cast<std::uint8_t>(byte);
+      for (bits += 8; bits >= 5; bits -= 5)
+        text += alphabet[(buffer >> (bits - 5)) & 0x1F];
+    }
+    if (bits > 0)
+      text += alphabet[(buffer << (5 - bits)) & 0x1F];
+    return text;
+  }
+
+  std::string encode_varint(std::uint64_t value)
+  {
+    std::string bytes;
+    for (; value >= 0x80; value >>= 7)
+      bytes += static_cast<char>((value & 0x7F) | 0x80);
+    return bytes + static_cast<char>(value);
+  }
+
+  std::string encode_field(std::uint64_t number, const std::string& bytes)
+  {
+    return encode_varint((number << 3) | 2) + encode_varint(bytes.size()) + bytes;
+  }
+
+  /**
+   * Write a dag-pb file node (without content of its own) to the repository, the block hash is not verified so the digest
+   * is just the id. Returns the CIDv1 of the node.
+   */
+  std::string write_file_node(const std::string& repo_path,
+                              char id,
+                              const std::vector<std::string>& children,
+                              const std::vector<std::uint64_t>& block_sizes,
+                              std::uint64_t file_size)
+  {
+    std::string unixfs = std::string("\x08\x02", 2) + "\x18" + encode_varint(file_size);
+    for (std::uint64_t block_size : block_sizes)
+      unixfs += "\x20" + encode_varint(block_size);
+    std::string node;
+    for (const std::string& child : children)
+      node += encode_field(2, encode_field(1, child));
+    node += encode_field(1, unixfs);
+    std::string multihash = "\x12\x20" + std::string(32, id);
+    std::string key = encode_base32(multihash);
+    std::filesystem::path shard = std::filesystem::path(repo_path) / "blocks" / key.substr(key.size() - 3, 2);
+    std::filesystem::create_directories(shard);
+    File::write((shard / (key + ".data")).string(), node);
+    return std::string("\x01\x70", 2) + multihash;
+  }
+
+  TEST(LibreWebTest, TestLocalBlockstoreReadFile)
+  {
+    // Given
+    std::string repo_path = create_repository("libreweb_blockstore_read");
+    LocalBlockstore blockstore(repo_path);
+    CancellationToken token;
+    std::size_t read_length = 0;
+    std::string content_v0;
+    std::string content_v1;
+    std::string leaf_content;
+    auto append_to = [](std::string& content)
+    {
+      return [&content](const char* data, std::size_t length)
+      {
+        content.append(data, length);
+        return true;
+      };
+    };
+
+    // When
+    bool is_read_v0 = blockstore.read_file(RootCidV0, append_to(content_v0), token, read_length);
+    bool is_read_v1 = blockstore.read_file(RootCidV1, append_to(content_v1), token, read_length);
+    bool is_read_leaf = blockstore.read_file(LeafCid, append_to(leaf_content), token, read_length);
+
+    // Then
+    ASSERT_TRUE(is_read_v0);
+    ASSERT_TRUE(is_read_v1);
+    ASSERT_TRUE(is_read_leaf);
+    ASSERT_EQ(content_v0, "# Title\n\nSome **text**.\n");
+    ASSERT_EQ(content_v1, content_v0);
+    ASSERT_EQ(leaf_content, "# Title\n\n");
+    ASSERT_EQ(read_length, 9);
+    std::filesystem::remove_all(repo_path);
+  }
+
+  TEST(LibreWebTest, TestLocalBlockstoreMiss)
+  {
+    // Given
+    std::string repo_path = create_repository("libreweb_blockstore_miss");
+    std::filesystem::remove(std::filesystem::path(repo_path) / "blocks" / "OD" / "CIQI5MM3YLSJWTIFOT5D6UFJIJXKLF6QEXIDJWTVK53XHBCPC3JZODI.data");
+    LocalBlockstore blockstore(repo_path);
+    CancellationToken token;
+    std::size_t read_length = 0;
+    std::string content;
+    auto append = [&content](const char* data, std::size_t length)
+    {
+      content.append(data, length);
+      return true;
+    };
+
+    // When
+    bool is_read = blockstore.read_file(RootCidV0, append, token, read_length);
+
+    // Then
+    // The second leaf is missing, the content after the first leaf still needs to be fetched
+    ASSERT_FALSE(is_read);
+    ASSERT_EQ(read_length, 9);
+    ASSERT_EQ(content, "# Title\n\n");
+    // Directories and paths are left to the IPFS API
+    ASSERT_FALSE(blockstore.read_file(EmptyDirectoryCid, append, token, read_length));
+    ASSERT_EQ(read_length, 0);
+    ASSERT_FALSE(blockstore.read_file(std::string(RootCidV0) + "/index.md", append, token, read_length));
+    ASSERT_FALSE(LocalBlockstore(repo_path + "_missing").read_file(LeafCid, append, token, read_length));
+    ASSERT_EQ(read_length, 0);
+    ASSERT_EQ(content, "# Title\n\n");
+    std::filesystem::remove_all(repo_path);
+  }
+
+  TEST(LibreWebTest, TestLocalBlockstoreStopReading)
+  {
+    // Given
+    std::string repo_path = create_repository("libreweb_blockstore_stop");
+    LocalBlockstore blockstore(repo_path);
+    CancellationToken token;
+    std::size_t read_length = 0;
+    std::string content;
+
+    // When
+    bool is_read = blockstore.read_file(
+        RootCidV0,
+        [&content](const char* data, std::size_t length)
+        {
+          content.append(data, length);
+          return false;
+        },
+        token, read_length);
+
+    // Then
+    ASSERT_TRUE(is_read);
+    ASSERT_EQ(content, "# Title\n\n");
+    std::filesystem::remove_all(repo_path);
+  }
+
+  TEST(LibreWebTest, TestLocalBlockstoreInvalidSizes)
+  {
+    // Given
+    std::string repo_path = create_repository("libreweb_blockstore_sizes");
+    // Inline leaf (identity hash) with "abc"
+    std::string leaf = std::string("\x01\x55\x00\x03", 4) + "abc";
+    // Links the leaf twice, but declares a smaller file size
+    std::string repeated = write_file_node(repo_path, 1, {leaf, leaf}, {3, 3}, 3);
+    // Declares a larger size for the leaf than it contains
+    std::string larger = write_file_node(repo_path, 2, {leaf}, {300}, 300);
+    LocalBlockstore blockstore(repo_path);
+    CancellationToken token;
+    std::size_t read_length = 0;
+    int chunk_count = 0;
+    auto count = [&chunk_count](const char*, std::size_t)
+    {
+      chunk_count++;
+      return true;
+    };
+
+    // When
+    bool is_repeated_read = blockstore.read_file("B" + encode_base32(repeated), count, token, read_length);
+    bool is_larger_read = blockstore.read_file("B" + encode_base32(larger), count, token, read_length);
+
+    // Then
+    ASSERT_FALSE(is_repeated_read);
+    ASSERT_FALSE(is_larger_read);
+    ASSERT_EQ(read_length, 0);
+    ASSERT_EQ(chunk_count, 0);
+    std::filesystem::remove_all(repo_path);
+  }
+
+  TEST(LibreWebTest, TestLocalBlockstoreCancelReading)
+  {
+    // Given
+    std::string repo_path = create_repository("libreweb_blockstore_cancel");
+    // Each node links its child twice: a file of 3 * 2^40 bytes, from only 40 blocks
+    std::string node = std::string("\x01\x55\x00\x03", 4) + "abc";
+    std::uint64_t size = 3;
+    for (char id = 1; id <= 40; ++id, size *= 2)
+      node = write_file_node(repo_path, id, {node, node}, {size, size}, size * 2);
+    LocalBlockstore blockstore(repo_path);
+    CancellationToken token;
+    std::size_t read_length = 0;
+    std::string content;
+
+    // When
+    bool is_read = blockstore.read_file(
+        "B" + encode_base32(node),
+        [&content, &token](const char* data, std::size_t length)
+        {
+          content.append(data, length);
+          // The content is passed on while walking the DAG, the request can be cancelled after the first chunks
+          if (content.size() >= 9)
+            token.cancel();
+          return true;
+        },
+        token, read_length);
+
+    // Then
+    ASSERT_TRUE(is_read);
+    ASSERT_EQ(content, "abcabcabc");
+    ASSERT_EQ(read_length, 9);
+    std::filesystem::remove_all(repo_path);
+  }
+} // namespace
@@ -14,8 +14,9 @@ public:
   MOCK_METHOD(std::string, do_add, (const std::string& path), (override));
   MOCK_METHOD(void, do_write, (const std::string& path, bool is_set_address_and_title), (override));
   MOCK_METHOD(void, set_content, (const Glib::ustring& content), (override));
-  MOCK_METHOD(Glib::ustring, get_content, (), (const, override));
+  MOCK_METHOD(ContentBuffer, get_content, (), (const, override));
   MOCK_METHOD(cmark_node*, parse_content, (), (const, override));
+  MOCK_METHOD(void, do_preview, (const Glib::ustring& content), (override));
   MOCK_METHOD(void, reset_content_and_path, (), (override));
   MOCK_METHOD(std::size_t, get_ipfs_number_of_peers, (), (const, override));
   MOCK_METHOD(int, get_ipfs_repo_size, (), (const, override));
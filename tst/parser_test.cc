@@ -1,8 +1,20 @@
+#include "content-sniffer.h"
+#include "disk-cache.h"
+#include "document-cache.h"
+#include "incremental-parser.h"
 #include "md-parser.h"
+#include "render-document.h"
+#include "stream-parser.h"
 #include "gtest/gtest.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
 #include <cmark-gfm.h>
+#include <filesystem>
+#include <fstream>
 #include <node.h>
 #include <string>
+#include <vector>
 namespace
 {
   TEST(LibreWebTest, TestContentParser)
@@ -19,6 +31,31 @@ namespace
     cmark_node_free(doc);
   }
 
+  TEST(LibreWebTest, TestCancellableContentParser)
+  {
+    // Given, content larger than a single parse chunk
+    std::string markdown;
+    for (int i = 0; i < 5000; ++i)
+    {
+      markdown += "# Heading " + std::to_string(i) + "\n\nParagraph with **bold** and _italic_ text, number " + std::to_string(i) + ".\n\n";
+    }
+    CancellationToken token;
+    CancellationToken cancelled_token;
+    cancelled_token.cancel();
+
+    // When
+    cmark_node* doc = Parser::parse_content(markdown);
+    cmark_node* chunked_doc = Parser::parse_content(markdown, token);
+    cmark_node* cancelled_doc = Parser::parse_content(markdown, cancelled_token);
+
+    // Then
+    ASSERT_NE(chunked_doc, nullptr);
+    ASSERT_EQ(Parser::render_html(chunked_doc), Parser::render_html(doc));
+    ASSERT_EQ(cancelled_doc, nullptr);
+    cmark_node_free(doc);
+    cmark_node_free(chunked_doc);
+  }
+
   TEST(LibreWebTest, TestHTMLRender)
   {
     // Given
@@ -47,4 +84,335 @@ namespace
     // Then
     ASSERT_EQ(markdown_again, markdown + "\n");
   }
+
+  TEST(LibreWebTest, TestRenderDocument)
+  {
+    // Given
+    std::string markdown = "# Title\n\nSome **bold** [link](ipfs://url) and [same](ipfs://url)\n\n> Quote";
+
+    // When
+    cmark_node* doc = Parser::parse_content(markdown);
+    auto document = RenderDocument::compile(doc);
+    cmark_node_free(doc);
+    std::string text;
+    std::vector<std::uint16_t> heading_levels;
+    std::vector<std::uint32_t> heading_lines;
+    std::vector<std::string> links;
+    std::vector<std::uint16_t> formats;
+    for (const RenderOp& op : document->get_ops())
+    {
+      std::string op_text(document->get_text(op), op.text_length);
+      if (op.type == RenderOp::OP_HEADING)
+      {
+        heading_levels.push_back(op.heading_level);
+        heading_lines.push_back(op.source_line);
+        continue;
+      }
+      text += op_text;
+      if (op.type == RenderOp::OP_LINK)
+        links.push_back(document->get_link(op));
+      else
+        formats.push_back(op.format);
+    }
+
+    // Then
+    ASSERT_EQ(text, "Title\n\nSome bold link and same\n\n\uFF5C Quote\n\n");
+    ASSERT_EQ(heading_levels, std::vector<std::uint16_t>{1});
+    ASSERT_EQ(heading_lines, std::vector<std::uint32_t>{1});
+    ASSERT_EQ(links, (std::vector<std::string>{"ipfs://url", "ipfs://url"}));
+    ASSERT_EQ(formats.front(), 1 << FORMAT_HEADING_SHIFT);
+    ASSERT_NE(std::find(formats.begin(), formats.end(), FORMAT_BOLD), formats.end());
+    ASSERT_EQ(document->get_blocks().size(), 3U);
+    ASSERT_EQ(document->get_blocks().back().start_line, 5U);
+    ASSERT_EQ(document->get_blocks().back().first_op + document->get_blocks().back().op_count, document->get_ops().size());
+  }
+
+  TEST(LibreWebTest, TestRenderDocumentDeserialize)
+  {
+    // Given
+    cmark_node* doc = Parser::parse_content("Text\n\n## Title\n");
+    auto document = RenderDocument::compile(doc);
+    cmark_node_free(doc);
+    std::string data;
+    document->serialize(data);
+    // Serialized heading operation: after the sizes (20 bytes) and the text pool
+    const auto& ops = document->get_ops();
+    auto is_heading = [](const RenderOp& op) { return op.type == RenderOp::OP_HEADING; };
+    std::size_t heading_index = static_cast<std::size_t>(std::find_if(ops.begin(), ops.end(), is_heading) - ops.begin());
+    std::uint64_t text_length = 0;
+    std::memcpy(&text_length, data.data(), sizeof(text_length));
+    std::size_t heading_level_offset = 20 + text_length + heading_index * sizeof(RenderOp) + offsetof(RenderOp, heading_level);
+    std::string corrupt = data;
+    corrupt[heading_level_offset] = 7;
+    // Invalid UTF-8 in the text pool
+    std::string invalid_text = data;
+    invalid_text[20] = '\xFF';
+
+    // When
+    auto restored = RenderDocument::deserialize(data.data(), data.size());
+    auto corrupt_restored = RenderDocument::deserialize(corrupt.data(), corrupt.size());
+    auto invalid_text_restored = RenderDocument::deserialize(invalid_text.data(), invalid_text.size());
+
+    // Then
+    ASSERT_LT(heading_index, ops.size());
+    ASSERT_NE(restored, nullptr);
+    ASSERT_EQ(restored->get_ops().at(heading_index).heading_level, 2);
+    ASSERT_EQ(restored->get_ops().at(heading_index).source_line, 3U);
+    ASSERT_EQ(corrupt_restored, nullptr);
+    ASSERT_EQ(invalid_text_restored, nullptr);
+  }
+
+  TEST(LibreWebTest, TestFingerprint)
+  {
+    // Given
+    std::string markdown = "Paragraph with a [link](https://libreweb.org)\n\n# Heading";
+    std::string moved_markdown = "# Other heading\n\nParagraph with a [link](https://libreweb.org)";
+    std::string changed_markdown = "Paragraph with a [link](https://libreweb.org/changed)";
+
+    // When
+    cmark_node* doc = Parser::parse_content(markdown);
+    cmark_node* moved_doc = Parser::parse_content(moved_markdown);
+    cmark_node* changed_doc = Parser::parse_content(changed_markdown);
+    std::uint64_t fingerprint = Parser::get_fingerprint(cmark_node_first_child(doc));
+    std::uint64_t moved_fingerprint = Parser::get_fingerprint(cmark_node_last_child(moved_doc));
+    std::uint64_t changed_fingerprint = Parser::get_fingerprint(cmark_node_first_child(changed_doc));
+    std::uint64_t heading_fingerprint = Parser::get_fingerprint(cmark_node_last_child(doc));
+    cmark_node_free(doc);
+    cmark_node_free(moved_doc);
+    cmark_node_free(changed_doc);
+
+    // Then
+    ASSERT_EQ(fingerprint, moved_fingerprint);
+    ASSERT_NE(fingerprint, changed_fingerprint);
+    ASSERT_NE(fingerprint, heading_fingerprint);
+  }
+
+  TEST(LibreWebTest, TestIncrementalParser)
+  {
+    // Given
+    std::vector<std::string> edits = {
+        "# Title\n\nFirst paragraph\n\nSecond paragraph\n",
+        "# Title\n\nFirst paragraph, edited\n\nSecond paragraph\n",
+        "# Title\n\nFirst paragraph, edited\n\n```\ncode\n\nSecond paragraph\n",
+        "# Title\n\nFirst paragraph, edited\n\n```\ncode\n```\n\nSecond paragraph\n",
+        "# Title\n\n- item\n\nFirst paragraph, edited\n\n- item 2\n\nSecond paragraph\n",
+        "# Title\n\n- item\n\n- item 2\n\nSecond paragraph\n",
+        "# Title\n\n> quote\n\n    indented code\n\nSecond *paragraph*\n",
+        "Title\n===\n\n> quote\n\n    indented code\n\nSecond *paragraph*\n",
+        "Title\n===\n\n> quote\n\n    indented code\n\n[link]\n\n[link]: /url\n",
+        "",
+    };
+    IncrementalParser incremental_parser;
+
+    for (const std::string& markdown : edits)
+    {
+      // When
+      cmark_node* doc = incremental_parser.update(markdown);
+      std::string html = Parser::render_html(doc);
+      cmark_node* expected_doc = Parser::parse_content(markdown);
+      std::string expected_html = Parser::render_html(expected_doc);
+      cmark_node_free(expected_doc);
+
+      // Then
+      ASSERT_EQ(html, expected_html);
+    }
+  }
+
+  TEST(LibreWebTest, TestStreamParser)
+  {
+    // Given
+    std::string markdown = "# Title\n\nFirst **paragraph**\n\n```\ncode\n\nblock\n```\n\n- item 1\n- item 2\n\nLast paragraph\n";
+    cmark_node* expected_doc = Parser::parse_content(markdown);
+    std::string expected_html = Parser::render_html(expected_doc);
+    cmark_node_free(expected_doc);
+    StreamParser stream_parser;
+
+    // When
+    std::string html;
+    for (std::size_t offset = 0; offset < markdown.size(); offset += 3)
+    {
+      cmark_node* doc = stream_parser.feed(markdown.data() + offset, std::min<std::size_t>(3, markdown.size() - offset));
+      if (doc != nullptr)
+      {
+        html += Parser::render_html(doc);
+        cmark_node_free(doc);
+      }
+    }
+    bool is_streaming = stream_parser.is_streaming();
+    // All blocks are finished, except the last paragraph
+    cmark_node* last_doc = stream_parser.finish();
+    std::string last_html = Parser::render_html(last_doc);
+    cmark_node_free(last_doc);
+    std::string content = stream_parser.release_content();
+
+    // Then
+    ASSERT_TRUE(is_streaming);
+    ASSERT_FALSE(stream_parser.is_streaming());
+    ASSERT_EQ(content, markdown);
+    ASSERT_EQ(last_html, "<p>Last paragraph</p>\n");
+    ASSERT_EQ(html + last_html, expected_html);
+  }
+
+  TEST(LibreWebTest, TestDocumentCacheKey)
+  {
+    // Given
+    std::string cid = "QmQQQyYm8GcLBEE7H3NMQWfkyfU5yHiT5i1J98gbfDGRuX";
+
+    // When / Then
+    ASSERT_EQ(DocumentCache::get_key(cid), cid);
+    ASSERT_EQ(DocumentCache::get_key("/ipfs/" + cid + "/index.md"), cid + "/index.md");
+    ASSERT_EQ(DocumentCache::get_key(cid + "/"), cid);
+    ASSERT_EQ(DocumentCache::get_key("/ipns/libreweb.org"), "");
+    ASSERT_EQ(DocumentCache::get_key("libreweb.org/index.md"), "");
+  }
+
+  TEST(LibreWebTest, TestDocumentCacheEviction)
+  {
+    // Given
+    DocumentCache cache(3 * 1024);
+    auto content = std::make_shared<const std::string>(1000, 'x');
+    cmark_node* doc = Parser::parse_content("# Title");
+    auto document = RenderDocument::compile(doc);
+    cmark_node_free(doc);
+    CachedDocument entry;
+
+    // When
+    cache.put("first", content);
+    cache.put("second", content);
+    cache.get("first", entry);
+    cache.set_document("first", document);
+    cache.put("third", std::make_shared<const std::string>(1000, 'y'));
+
+    // Then
+    ASSERT_EQ(cache.get_entry_count(), 2U);
+    ASSERT_FALSE(cache.get("second", entry));
+    ASSERT_TRUE(cache.get("first", entry));
+    ASSERT_EQ(entry.document, document);
+    ASSERT_LE(cache.get_memory_usage(), 3U * 1024);
+    // Content larger than the memory limit is never cached
+    cache.put("large", std::make_shared<const std::string>(4096, 'z'));
+    ASSERT_FALSE(cache.get("large", entry));
+  }
+
+  TEST(LibreWebTest, TestDiskCache)
+  {
+    // Given
+    std::filesystem::path directory = std::filesystem::temp_directory_path() / "libreweb-disk-cache-test";
+    std::filesystem::remove_all(directory);
+    std::string markdown = "# Title\n\nSome [link](ipfs://url)";
+    cmark_node* doc = Parser::parse_content(markdown);
+    auto document = RenderDocument::compile(doc);
+    cmark_node_free(doc);
+    DiskCache cache(directory.string());
+    CachedDocument entry;
+
+    // When
+    cache.store("key", {std::make_shared<const std::string>(markdown), document});
+    bool is_found = DiskCache(directory.string()).load("key", entry);
+
+    // Then
+    ASSERT_TRUE(is_found);
+    ASSERT_EQ(*entry.content, markdown);
+    ASSERT_NE(entry.document, nullptr);
+    ASSERT_EQ(entry.document->get_ops().size(), document->get_ops().size());
+    ASSERT_EQ(entry.document->get_blocks().size(), document->get_blocks().size());
+    ASSERT_EQ(entry.document->get_link(entry.document->get_ops().back()), "ipfs://url");
+    ASSERT_FALSE(cache.load("other key", entry));
+
+    // Corrupt entries are removed
+    for (const auto& file : std::filesystem::directory_iterator(directory))
+    {
+      std::fstream stream(file.path(), std::ios::in | std::ios::out | std::ios::binary);
+      stream.seekp(-1, std::ios::end);
+      stream.put('X');
+    }
+    ASSERT_FALSE(cache.load("key", entry));
+    ASSERT_TRUE(std::filesystem::is_empty(directory));
+    std::filesystem::remove_all(directory);
+  }
+
+  TEST(LibreWebTest, TestContentSnifferText)
+  {
+    // Given
+    std::string text = "# Title\n\nSome text with \xC3\xA9 and \xF0\x9F\x8E\x82 characters, long enough for the fast path.\n";
+    ContentSniffer sniffer;
+
+    // When
+    bool is_text = true;
+    // Single bytes, so multi-byte characters are split between chunks
+    for (char c : text)
+    {
+      is_text = sniffer.feed(&c, 1) && is_text;
+    }
+    bool is_finished_text = sniffer.finish();
+
+    // Then
+    ASSERT_TRUE(is_text);
+    ASSERT_TRUE(is_finished_text);
+    ASSERT_TRUE(sniffer.get_type().empty());
+  }
+
+  TEST(LibreWebTest, TestContentSnifferInvalidText)
+  {
+    // Given
+    std::string overlong = "Text with an overlong \xC0\xAF slash";
+    std::string surrogate = "Text with a surrogate \xED\xA0\x80 character";
+    std::string null_character("Text with a null\0character", 26);
+    std::string cut_off = "Text with a cut-off \xE2\x82";
+
+    // When
+    ContentSniffer overlong_sniffer, surrogate_sniffer, null_sniffer, cut_off_sniffer;
+    bool is_overlong_text = overlong_sniffer.feed(overlong.data(), overlong.size());
+    bool is_surrogate_text = surrogate_sniffer.feed(surrogate.data(), surrogate.size());
+    bool is_null_text = null_sniffer.feed(null_character.data(), null_character.size());
+    bool is_cut_off_fed = cut_off_sniffer.feed(cut_off.data(), cut_off.size());
+    bool is_cut_off_text = cut_off_sniffer.finish();
+
+    // Then
+    ASSERT_FALSE(is_overlong_text);
+    ASSERT_FALSE(is_surrogate_text);
+    ASSERT_FALSE(is_null_text);
+    ASSERT_TRUE(is_cut_off_fed);
+    ASSERT_FALSE(is_cut_off_text);
+    ASSERT_EQ(null_sniffer.get_type(), "binary data");
+  }
+
+  TEST(LibreWebTest, TestContentSnifferBinaryType)
+  {
+    // Given
+    std::string png("\x89PNG\r\n\x1A\n\0\0\0\rIHDR", 16);
+    std::string tar(512, '\0');
+    tar.replace(0, 9, "notes.md");
+    tar.replace(257, 5, "ustar");
+
+    // When
+    ContentSniffer png_sniffer, tar_sniffer;
+    bool is_png_text = png_sniffer.feed(png.data(), 4);
+    png_sniffer.feed(png.data() + 4, png.size() - 4);
+    bool is_tar_text = tar_sniffer.feed(tar.data(), tar.size());
+
+    // Then
+    ASSERT_FALSE(is_png_text);
+    ASSERT_EQ(png_sniffer.get_type(), "PNG image");
+    ASSERT_FALSE(is_tar_text);
+    ASSERT_EQ(tar_sniffer.get_type(), "tar archive");
+  }
+
+  TEST(LibreWebTest, TestContentSnifferTextWithSignature)
+  {
+    // Given
+    std::string id3 = "ID3 tags of music files\n\nThe ID3 tags are stored at the start of an MP3 file.\n";
+    std::string mp4 = "The ftyp box is the first box of an MP4 file.\n";
+
+    // When
+    ContentSniffer id3_sniffer, mp4_sniffer;
+    bool is_id3_text = id3_sniffer.feed(id3.data(), id3.size()) && id3_sniffer.finish();
+    bool is_mp4_text = mp4_sniffer.feed(mp4.data(), mp4.size()) && mp4_sniffer.finish();
+
+    // Then
+    ASSERT_TRUE(is_id3_text);
+    ASSERT_TRUE(id3_sniffer.get_type().empty());
+    ASSERT_TRUE(is_mp4_text);
+    ASSERT_TRUE(mp4_sniffer.get_type().empty());
+  }
 } // namespace
\ No newline at end of file
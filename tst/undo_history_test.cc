@@ -0,0 +1,116 @@
+#include "undo-history.h"
+#include "gtest/gtest.h"
+#include <string>
+#include <vector>
+
+namespace
+{
+  std::string get_text(const UndoHistory& history, const UndoEdit& edit)
+  {
+    return std::string(history.get_text(edit), edit.text_length);
+  }
+
+  void type_text(UndoHistory& history, int offset, const std::string& text)
+  {
+    for (char c : text)
+    {
+      history.begin_action();
+      history.add_insert(offset++, std::string(1, c), 1);
+      history.end_action();
+    }
+  }
+
+  TEST(LibreWebTest, TestUndoHistoryCoalesceTyping)
+  {
+    // Given
+    UndoHistory history;
+
+    // When
+    type_text(history, 0, "Hello");
+    type_text(history, 5, "\n");
+    type_text(history, 6, "world");
+
+    // Then
+    ASSERT_EQ(history.get_undo_count(), 3U);
+    const std::vector<UndoEdit>* edits = history.undo();
+    ASSERT_NE(edits, nullptr);
+    ASSERT_EQ(edits->size(), 1U);
+    ASSERT_EQ(edits->front().begin_offset, 6);
+    ASSERT_EQ(edits->front().end_offset, 11);
+    ASSERT_EQ(get_text(history, edits->front()), "world");
+    ASSERT_EQ(history.get_redo_count(), 1U);
+  }
+
+  TEST(LibreWebTest, TestUndoHistoryGroupUserAction)
+  {
+    // Given
+    UndoHistory history;
+    type_text(history, 0, "abc");
+
+    // When
+    history.begin_action();
+    history.add_delete(1, 2, "b");
+    history.add_insert(1, "XYZ", 3);
+    history.end_action();
+
+    // Then
+    ASSERT_EQ(history.get_undo_count(), 2U);
+    const std::vector<UndoEdit>* edits = history.undo();
+    ASSERT_EQ(edits->size(), 2U);
+    ASSERT_FALSE(edits->at(0).is_insert);
+    ASSERT_EQ(get_text(history, edits->at(0)), "b");
+    ASSERT_TRUE(edits->at(1).is_insert);
+    ASSERT_EQ(get_text(history, edits->at(1)), "XYZ");
+    edits = history.redo();
+    ASSERT_EQ(edits->size(), 2U);
+    // New changes drop the redo steps
+    history.undo();
+    type_text(history, 3, "d");
+    ASSERT_EQ(history.get_redo_count(), 0U);
+  }
+
+  TEST(LibreWebTest, TestUndoHistoryCoalesceBackspace)
+  {
+    // Given
+    UndoHistory history;
+
+    // When
+    for (int offset = 3; offset > 0; --offset)
+    {
+      history.begin_action();
+      history.add_delete(offset - 1, offset, std::string(1, static_cast<char>('a' + offset - 1)));
+      history.end_action();
+    }
+
+    // Then
+    ASSERT_EQ(history.get_undo_count(), 1U);
+    const std::vector<UndoEdit>* edits = history.undo();
+    ASSERT_EQ(edits->size(), 3U);
+    ASSERT_EQ(edits->back().begin_offset, 0);
+    ASSERT_EQ(get_text(history, edits->back()), "a");
+  }
+
+  TEST(LibreWebTest, TestUndoHistoryMemoryLimit)
+  {
+    // Given
+    UndoHistory history(4096);
+    std::string large_text(1024, 'x');
+
+    // When
+    for (int i = 0; i < 100; ++i)
+    {
+      history.begin_action();
+      history.add_insert(i * 1024, large_text, 1024);
+      history.end_action();
+    }
+
+    // Then
+    ASSERT_GT(history.get_undo_count(), 0U);
+    ASSERT_LT(history.get_undo_count(), 4U);
+    // The text arena is compacted once there is enough unused text
+    ASSERT_LT(history.get_memory_usage(), 4096U + 2 * 64 * 1024);
+    history.set_max_bytes(0);
+    ASSERT_EQ(history.get_undo_count(), 1U);
+    ASSERT_EQ(get_text(history, history.undo()->front()), large_text);
+  }
+} // namespace